@@ -16,66 +16,271 @@
 */
 
 #include "Household.h"
+#include "globals.h"
 #include <string.h>
+#include <algorithm>
 
-bool CHousehold::CalculateBHR(long NumberofBIR)
+// room for the BHRs of NumberofHH households, with the number of members from the
+// household index (missing ones 0)
+bool CHouseholds::PrepareHouseholdBHR(long NumberofHH, long NumberofBIR, const std::vector<long> &NumberofMembers)
 {
-    long i,j,k;
+    long i;
+
+    Clear();
+    if (NumberofBIR <= 0) {
+	return false;
+    }
+    m_nHH = NumberofHH;
+    m_nBIR = NumberofBIR;
+    m_NumberofMembers.assign(m_nHH, 0);
+    m_MemberStart.assign(m_nHH + 1, 0);
+    for (i = 0; i < m_nHH; i++) {
+        if (i < (long) NumberofMembers.size()) {
+            m_NumberofMembers[i] = NumberofMembers[i];
+        }
+        m_MemberStart[i + 1] = m_MemberStart[i] + m_NumberofMembers[i];
+    }
+    m_BHR.assign(m_nBIR, std::vector<double>(m_nHH, 0));
+    return true;
+}
+
+// room for the BIRs of all members, set to 0
+bool CHouseholds::PrepareHouseholdBIR()
+{
+    if (m_nBIR <= 0) {
+        return false;
+    }
+    m_BIR.assign(m_nBIR, std::vector<double>(m_MemberStart[m_nHH], 0));
+    return true;
+}
+
+void CHouseholds::SaveBIR(long HHNum, long MemberNumber, double *BIRarray)
+{
+    long i, m = m_MemberStart[HHNum] + MemberNumber;
+    for (i=0; i<m_nBIR; i++)	{
+	m_BIR[i][m] = BIRarray[i];
+    }
+}
+
+// BHR = sum over the members i of BIR_i * prod_{j<i} (1 - BIR_j), with a running
+// product in the same order of multiplication as the member by member formula
+bool CHouseholds::CalculateBHR(long HHNum)
+{
+    long i,k;
     double tempsum, tempproduct;
+    long n = m_NumberofMembers[HHNum];
 
-    if (m_lNumberofMembers <= 0) {
+    if (n <= 0) {
 	return false;
     }
-    tempsum = 0;
-    for (k=0; k<NumberofBIR; k++) {
-	for (i=0; i<m_lNumberofMembers; i++){
-            tempproduct = 1;
-            for (j=0; j<i; j++)	{
-		tempproduct = tempproduct*(1-m_dBIRarray[(k*m_lNumberofMembers)+j]);
-            }
-            tempproduct = tempproduct*m_dBIRarray[(k*m_lNumberofMembers)+i];
-            tempsum = tempsum+tempproduct;
+    for (k=0; k<m_nBIR; k++) {
+        const double *BIR = &m_BIR[k][m_MemberStart[HHNum]];
+        tempsum = 0;
+        tempproduct = 1;
+	for (i=0; i<n; i++){
+            tempsum = tempsum+tempproduct*BIR[i];
+            tempproduct = tempproduct*(1-BIR[i]);
 	}
-	//first clear the BIRarray
-	m_dBHR[k] = tempsum;
-	tempsum = 0;
-	tempproduct = 1;
+	m_BHR[k][HHNum] = tempsum;
     }
-    delete[] m_dBIRarray;
-    m_dBIRarray = 0;
     return true;
 }
 
-bool CHousehold::PrepareHouseholdBIR(long NumberofBIR)
+// the BIRs of the members are only needed to compute the BHRs
+void CHouseholds::ClearHouseholdBIR()
 {
-    if ((m_lNumberofMembers <1)|| (NumberofBIR<=0))	{
-        return false;
+    std::vector< std::vector<double> >().swap(m_BIR);
+}
+
+void CHouseholds::Clear()
+{
+    m_nHH = 0;
+    m_nBIR = 0;
+    std::vector<long>().swap(m_NumberofMembers);
+    std::vector<long>().swap(m_MemberStart);
+    std::vector< std::vector<double> >().swap(m_BIR);
+    std::vector< std::vector<double> >().swap(m_BHR);
+}
+
+CRecordSort::CRecordSort(int KeyLength)
+{
+    m_KeyLength = KeyLength;
+    m_Buf.resize(KeyLength + 2 * sizeof(long) + 1);
+    m_RunNext = 0;
+}
+
+CRecordSort::~CRecordSort()
+{
+    for (long i = 0; i < (long) m_RunFile.size(); i++) {
+        fclose(m_RunFile[i]);
     }
-    m_dBIRarray = new double [m_lNumberofMembers*NumberofBIR];
-    if (m_dBIRarray == 0) {
-        return false;
+}
+
+// adds record Seq at file position Pos, with its key cut at KeyLength characters
+bool CRecordSort::Add(const std::string &Key, long Seq, long Pos)
+{
+    CRecordKey k;
+
+    k.Key = Key.substr(0, m_KeyLength);
+    k.Seq = Seq;
+    k.Pos = Pos;
+    m_Run.push_back(k);
+    if ((long) m_Run.size() >= RECORDSORTRUN) {
+        return WriteRun();
     }
-    memset(m_dBIRarray, 0, m_lNumberofMembers *NumberofBIR* sizeof(double) );
     return true;
 }
 
-bool CHousehold::PrepareHouseholdBHR(long NumberofBIR)
+// sorts the records added. Runs are merged to fewer, longer runs until at most
+// RECORDSORTMERGE are left, these are merged by Next. false if a run can not be
+// written or read
+bool CRecordSort::Sort()
 {
-    if (NumberofBIR<= 0) {
-	return false;
+    long i, j, n;
+
+    m_RunNext = 0;
+    if (m_RunFile.empty()) {  // all keys in memory
+        std::sort(m_Run.begin(), m_Run.end());
+        return true;
     }
-    m_dBHR = new double [NumberofBIR];
-    if (m_dBHR == 0) {
-	return false;
+    if (!m_Run.empty() && !WriteRun()) {
+        return false;
+    }
+    while ((long) m_RunFile.size() > RECORDSORTMERGE) {
+        std::vector<FILE *> Merged;
+        bool Oke = true;
+        n = m_RunFile.size();
+        for (i = 0; Oke && i < n; i += RECORDSORTMERGE) {
+            FILE *fd = tmpfile();
+            if (fd == 0) {
+                Oke = false;
+                break;
+            }
+            Merged.push_back(fd);
+            Oke = MergeRuns(i, std::min(i + RECORDSORTMERGE, n), fd);
+        }
+        for (j = 0; j < n; j++) {
+            fclose(m_RunFile[j]);
+        }
+        m_RunFile.swap(Merged);
+        if (!Oke) {
+            return false;
+        }
+    }
+
+    n = m_RunFile.size();
+    m_Head.resize(n);
+    m_HeadState.resize(n);
+    for (i = 0; i < n; i++) {
+        rewind(m_RunFile[i]);
+        m_HeadState[i] = ReadKey(m_RunFile[i], m_Head[i]);
+        if (m_HeadState[i] == INFILE_ERROR) {
+            return false;
+        }
     }
-    memset(m_dBHR, 0, NumberofBIR* sizeof(double) );
     return true;
 }
 
-void CHousehold::SaveBIR(double *BIRarray, long NumberOfBIR, long MemberNumber)
+// the next record in order of key: INFILE_OKE, INFILE_EOF after the last one or
+// INFILE_ERROR if a run can not be read
+int CRecordSort::Next(CRecordKey &k)
 {
-    long i;
-    for (i=0; i<NumberOfBIR; i++)	{
-	m_dBIRarray[i*m_lNumberofMembers + MemberNumber] = BIRarray[i];
+    if (m_RunFile.empty()) {
+        if (m_RunNext >= (long) m_Run.size()) {
+            return INFILE_EOF;
+        }
+        k = m_Run[m_RunNext++];
+        return INFILE_OKE;
+    }
+
+    long i = FirstHead(m_Head, m_HeadState);
+    if (i < 0) {
+        return INFILE_EOF;
+    }
+    k = m_Head[i];
+    m_HeadState[i] = ReadKey(m_RunFile[i], m_Head[i]);
+    return m_HeadState[i] == INFILE_ERROR ? INFILE_ERROR : INFILE_OKE;
+}
+
+// the keys in memory sorted to a new run file
+bool CRecordSort::WriteRun()
+{
+    FILE *fd = tmpfile();
+    if (fd == 0) {
+        return false;
+    }
+    m_RunFile.push_back(fd);
+    std::sort(m_Run.begin(), m_Run.end());
+    for (long i = 0; i < (long) m_Run.size(); i++) {
+        if (!WriteKey(fd, m_Run[i])) {
+            return false;
+        }
+    }
+    m_Run.clear();
+    return fflush(fd) == 0;
+}
+
+// the runs First, ..., Last - 1 merged to one run in fd_out
+bool CRecordSort::MergeRuns(long First, long Last, FILE *fd_out)
+{
+    long i, n = Last - First;
+    std::vector<CRecordKey> Head(n);
+    std::vector<int> HeadState(n);
+
+    for (i = 0; i < n; i++) {
+        rewind(m_RunFile[First + i]);
+        HeadState[i] = ReadKey(m_RunFile[First + i], Head[i]);
+        if (HeadState[i] == INFILE_ERROR) {
+            return false;
+        }
+    }
+    while ((i = FirstHead(Head, HeadState)) >= 0) {
+        if (!WriteKey(fd_out, Head[i])) {
+            return false;
+        }
+        HeadState[i] = ReadKey(m_RunFile[First + i], Head[i]);
+        if (HeadState[i] == INFILE_ERROR) {
+            return false;
+        }
+    }
+    return fflush(fd_out) == 0;
+}
+
+// a key is written as KeyLength characters, Seq and Pos
+bool CRecordSort::WriteKey(FILE *fd, const CRecordKey &k)
+{
+    memset(&m_Buf[0], 0, m_KeyLength);
+    memcpy(&m_Buf[0], k.Key.c_str(), k.Key.size());
+    memcpy(&m_Buf[m_KeyLength], &k.Seq, sizeof(long));
+    memcpy(&m_Buf[m_KeyLength + sizeof(long)], &k.Pos, sizeof(long));
+    return fwrite(&m_Buf[0], m_KeyLength + 2 * sizeof(long), 1, fd) == 1;
+}
+
+// INFILE_OKE, INFILE_EOF at the end of the run or INFILE_ERROR if it can not be read
+int CRecordSort::ReadKey(FILE *fd, CRecordKey &k)
+{
+    size_t n = m_KeyLength + 2 * sizeof(long);
+    size_t nRead = fread(&m_Buf[0], 1, n, fd);
+
+    if (nRead != n) {
+        return (nRead == 0 && !ferror(fd)) ? INFILE_EOF : INFILE_ERROR;
+    }
+    memcpy(&k.Seq, &m_Buf[m_KeyLength], sizeof(long));
+    memcpy(&k.Pos, &m_Buf[m_KeyLength + sizeof(long)], sizeof(long));
+    m_Buf[m_KeyLength] = 0;
+    k.Key = &m_Buf[0];
+    return INFILE_OKE;
+}
+
+// the run with the lowest first key, -1 if all runs are done
+long CRecordSort::FirstHead(const std::vector<CRecordKey> &Head, const std::vector<int> &HeadState)
+{
+    long i, First = -1;
+
+    for (i = 0; i < (long) Head.size(); i++) {
+        if (HeadState[i] == INFILE_OKE && (First < 0 || Head[i] < Head[First])) {
+            First = i;
+        }
     }
+    return First;
 }
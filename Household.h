@@ -18,40 +18,166 @@
 #if !defined Household_h
 #define Household_h
 
-class CHousehold
+#include <stdio.h>
+#include <vector>
+#include <string>
+
+// the households of the data file with the risks of their members, stored per array
+// for all households: member counts, the start of every household in the member
+// arrays (CSR) and per BIR table the BIR of every member and the BHR of every household
+class CHouseholds
 {
 public:
 
-	CHousehold()
+	CHouseholds()
 	{
-            m_lNumberofMembers = 0;
-            m_dBIRarray = 0;
-            m_dBHR = 0;
-
+            m_nHH = 0;
+            m_nBIR = 0;
 	}
-	~CHousehold()
+
+	long m_nHH;
+	long m_nBIR;
+	std::vector<long> m_NumberofMembers;            // per household
+	std::vector<long> m_MemberStart;                // per household the index of its first member, m_nHH + 1
+	std::vector< std::vector<double> > m_BIR;       // per BIR table the BIR of every member
+	std::vector< std::vector<double> > m_BHR;       // per BIR table the BHR of every household
+
+	bool PrepareHouseholdBHR(long NumberofHH, long NumberofBIR, const std::vector<long> &NumberofMembers);
+	bool PrepareHouseholdBIR();
+	void SaveBIR(long HHNum, long MemberNumber, double *BIRarray);
+	bool CalculateBHR(long HHNum);
+	void ClearHouseholdBIR();
+	void Clear();
+};
+
+// a record of a file with its sort key, see CRecordSort
+class CRecordKey
+{
+public:
+	std::string Key;
+	long Seq;       // number of the record in the file (0, 1, ...), keeps equal keys in file order
+	long Pos;       // file position of the record
+
+	bool operator<(const CRecordKey &k) const
 	{
-            if (m_dBHR != 0)
-            {
-		delete[] m_dBHR;
-            }
-            if (m_dBIRarray != 0)
-            {
-            delete[] m_dBIRarray;
+            if (Key != k.Key) {
+                return Key < k.Key;
             }
-            m_dBIRarray = 0;
+            return Seq < k.Seq;
 	}
-        
-	long m_lNumberofMembers;
-	double *m_dBIRarray;
-	double *m_dBHR;
+};
+
+// external merge sort of the records of a file on a key of at most KeyLength characters:
+// the keys with the file positions of the records are sorted in memory in runs of
+// RECORDSORTRUN records, written to temporary files and merged RECORDSORTMERGE runs at a time.
+// Add all records, Sort, then Next gives them in order of key
+class CRecordSort
+{
+public:
+
+	CRecordSort(int KeyLength);
+	~CRecordSort();
 
-	bool CalculateBHR(long NumberofBIR);
-	bool PrepareHouseholdBIR(long NumberofBIR);
-	bool PrepareHouseholdBHR(long NumberofBIR);
-	void SaveBIR(double * BIRarray, long NumberOfBIR, long MemberNumber);
+	bool Add(const std::string &Key, long Seq, long Pos);
+	bool Sort();
+	int Next(CRecordKey &k);
 
+private:
+	int m_KeyLength;
+	std::vector<char> m_Buf;              // a key as written to a run file, see WriteKey
+	std::vector<CRecordKey> m_Run;        // the keys not written to a run file
+	long m_RunNext;                       // next key of m_Run if there are no run files
+	std::vector<FILE *> m_RunFile;        // the sorted runs
+	std::vector<CRecordKey> m_Head;       // per run its first key not yet given by Next
+	std::vector<int> m_HeadState;         // per run INFILE_OKE if it has one, else INFILE_EOF
+
+	bool WriteRun();
+	bool MergeRuns(long First, long Last, FILE *fd_out);
+	bool WriteKey(FILE *fd, const CRecordKey &k);
+	int ReadKey(FILE *fd, CRecordKey &k);
+	static long FirstHead(const std::vector<CRecordKey> &Head, const std::vector<int> &HeadState);
+};
+
+// the state of MakeRecordSafe for a record, so every thread can make its own records safe:
+// the code indices, the variables to set on missing and the unsafe combinations of UCList
+class CSafeRecordState
+{
+public:
+	void Prepare(int nVar, int nUC)
+	{
+            TableIndex.assign(nVar, -1);
+            TableIsMissing.assign(nVar, false);
+            SetMissing.assign(nVar, false);
+            freq.assign(nVar, 0);
+            unsafe.assign(nUC, false);
+            nUnsafe = 0;
+	}
+	std::vector<int> TableIndex;       // per variable the index in table
+	std::vector<bool> TableIsMissing;  // per variable: index is Missing
+	std::vector<bool> SetMissing;      // per variable: set on missing
+	std::vector<int> freq;             // per variable the frequency in unsafe tables
+	std::vector<bool> unsafe;          // per entry of UCList: combination of variables is unsafe?
+	long nUnsafe;                      // number of unsafe records
+};
 
+// a block of records read by MakeFileSafe: whole households, made safe (in parallel) and
+// then written in the order of the file
+class CSafeFileBlock
+{
+public:
+	CSafeFileBlock()
+	{
+            Clear();
+	}
+	void Clear()
+	{
+            nRec = 0;
+            nHH = 0;
+            HHFirst.clear();
+            HHNum.clear();
+            HHSize.clear();
+	}
+	void AddHousehold(long Num, long Size)
+	{
+            HHFirst.push_back(nRec);
+            HHNum.push_back(Num);
+            HHSize.push_back(Size);
+            nHH++;
+	}
+	void AddRecord(const char *record, long recnr)
+	{
+            if (nRec < (long) Record.size()) {
+                Record[nRec].assign(record);
+                RecNr[nRec] = recnr;
+            }
+            else {
+                Record.push_back(record);
+                RecNr.push_back(recnr);
+            }
+            nRec++;
+	}
+	long HHEnd(long h) const
+	{
+            return h + 1 < nHH ? HHFirst[h + 1] : nRec;
+	}
+	// keeps the result of MakeRecordSafe for record r
+	void Keep(long r, const CSafeRecordState &s)
+	{
+            long i, nVar = s.TableIndex.size();
+            for (i = 0; i < nVar; i++) {
+                TableIndex[r * nVar + i] = s.TableIndex[i];
+                SetMissing[r * nVar + i] = s.SetMissing[i];
+            }
+	}
 
+	long nRec;
+	long nHH;
+	std::vector<std::string> Record;   // the records as read, the strings are reused
+	std::vector<long> RecNr;           // per record the record number in the file
+	std::vector<long> HHFirst;         // per household the index of its first record
+	std::vector<long> HHNum;           // per household its number in the file, -1 if no households
+	std::vector<long> HHSize;          // per household the number of members (see ExploreFile)
+	std::vector<int> TableIndex;       // per record and variable the index in table
+	std::vector<char> SetMissing;      // per record and variable: set on missing
 };
 #endif 
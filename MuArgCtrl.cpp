@@ -23,8 +23,10 @@
 #include <string.h>
 #include <assert.h>
 #include <time.h>
+#include <limits.h>
 
 #include <vector>
+#include <set>
 #include <string>
 #include <algorithm>
 #include <sstream>
@@ -187,10 +189,12 @@ bool CMuArgCtrl::SetVariable(long Index, long bPos, long nPos, long nDec, std::s
 /**
  * Examines of each categorical variable which codes occur. In fixed format input files,
  * all records are of equal length. The only exception are empty records, which are ignored 
- * without warning
+ * without warning. The records of a household file are first grouped on HHIdent if asked
+ * for, see SetHouseholdGrouping
  * @param FileName      Name of file to be investigated
  * @param ErrorCode     
  *                      FILENOTFOUND    file can not be opened
+ *                      CANTOPENFILE    the grouped copy can not be written or the data file not reread
  *                      EMPTYFILE       file is empty
  *                      WRONGLENGTH     not all record lengths are equal
  *                      RECORDTOOSHORT  a variable does not fit within specified record length
@@ -215,6 +219,17 @@ bool CMuArgCtrl::ExploreFile(std::string FileName, long *ErrorCode, long *LineNu
 	return false;
     }
 
+    // codes can change, recodes kept for undo/redo and hierarchies are of no use anymore
+    for (i = 0; i < m_nvar; i++) {
+        m_var[i].ClearRecodeCache();
+        m_var[i].ClearHierarchy();
+    }
+    FreeLevelTables(-1);
+
+    m_HHnRec.clear();
+    PrepareRecCodes();
+    ClearHouseholdGrouping();
+
     fd = fopen(sFileName.c_str(), "r");
     if (fd == 0) {
         *ErrorCode = FILENOTFOUND;
@@ -257,6 +272,29 @@ bool CMuArgCtrl::ExploreFile(std::string FileName, long *ErrorCode, long *LineNu
         }
     }
 
+    // records of a household not contiguous: explore and use the grouped copy from here on
+    if (m_bHasHH && !m_GroupFileName.empty()) {
+        bool Grouped;
+        if (m_GroupFileName == sFileName) {
+            *ErrorCode = CANTOPENFILE;
+            goto error;
+        }
+        if (!GroupHouseholdFile(fd, ErrorCode, LineNumber, &Grouped)) {
+            goto error;
+        }
+        if (Grouped) {
+            fclose(fd);
+            sFileName = m_GroupFileName;
+            fd = fopen(sFileName.c_str(), "r");
+            if (fd == 0) {
+                *ErrorCode = CANTOPENFILE;
+                return false;
+            }
+            fseek(fd, 0, SEEK_END);
+            m_fSize = ftell(fd);
+        }
+    }
+
     int res;
     rewind(fd);
     if ((!m_InFileIsFixedFormat)&&(m_IgnoreFirstLine)) {
@@ -283,9 +321,15 @@ bool CMuArgCtrl::ExploreFile(std::string FileName, long *ErrorCode, long *LineNu
                     FireUpdateProgress((int)(ftell(fd) * 100.0 / m_fSize));  // for progressbar in container
 		}
 		if (m_bHasHH) {
+                    long nHH = tempNumberofHH;
                     if (!NumberOfHH(str, tempNumberofHH) )	{
                         goto error;
                     }
+                    // household sizes, so later passes need not count the members
+                    if (m_HHnRec.empty() || tempNumberofHH != nHH) {
+                        m_HHnRec.push_back(0);
+                    }
+                    m_HHnRec.back()++;
 		}
 		if (!DoMicroRecord(str, &varindex) ) {
                     *ErrorCode = WRONGRECORD;
@@ -554,10 +598,8 @@ void CMuArgCtrl::CleanUp()
     // tables
     CleanTables();
     
-    if (m_HH != 0) {
-        delete[] m_HH;
-    }
-    m_HH = 0;
+    m_HH.Clear();
+    m_BHRIndex.clear();
     
     // List Unsafe Combinations
     if (m_UCList != 0) {
@@ -567,6 +609,18 @@ void CMuArgCtrl::CleanUp()
 
     // number unsafe combinations
     m_nUC = 0;
+    m_nPrunedUC = 0;
+    m_UCHash.clear();
+    m_UCNext.clear();
+    m_UCProfile.clear();
+    m_UCProfileStart.clear();
+    m_UCProfileValid = false;
+    m_BIRCellsValid = false;
+    m_VarRecodeChanged.clear();
+    m_RecodeTablesValid = false;
+    for (int d = 0; d <= MAXDIM; d++) {
+        m_UCDimList[d].clear();
+    }
 
     // name datafile
     m_fname[0] = 0;
@@ -590,6 +644,9 @@ void CMuArgCtrl::CleanUp()
 
     m_lNumBIRs = 0;
     m_lNumberOfHH = 0;
+    m_HHnRec.clear();
+    PrepareRecCodes();
+    ClearHouseholdGrouping();
 }
 
 void CMuArgCtrl::CleanVars()
@@ -609,6 +666,11 @@ void CMuArgCtrl::CleanVars()
 
 void CMuArgCtrl::CleanTables()
 {
+    ClearRecodedTablesCache();
+    FreeLevelTables(-1);
+    m_BIRCells.clear();
+    m_BIRCellsValid = false;
+
     // also free the used Cells from the tables
     if (m_ntab != 0) {
         for (int i = 0; i < m_ntab + m_ntab; i++) {
@@ -703,6 +765,8 @@ bool CMuArgCtrl::SetTable(long TabIndex, long Threshold, long nDim, long *VarLis
         return false;
     }
     m_tab[i].BIRThreshold = 0;  // of Threshold? AWTG 21-8-2001
+    m_UCProfileValid = false;
+    m_BIRCellsValid = false;
 
     return true;
 }
@@ -829,6 +893,159 @@ bool CMuArgCtrl::BaseIndividualRisk(long fk, double Fk, double *risk)
     return true;
 }
 
+// orders the indices of (fk, Fk) pairs, equal pairs adjacent
+class CRiskPairLess
+{
+public:
+    CRiskPairLess(const long *fk, const double *Fk) : m_fk(fk), m_Fk(Fk) {}
+    bool operator()(long a, long b) const
+    {
+        if (m_fk[a] != m_fk[b]) return m_fk[a] < m_fk[b];
+        return m_Fk[a] < m_Fk[b];
+    }
+private:
+    const long *m_fk;
+    const double *m_Fk;
+};
+
+// orders indices of cells, households or thresholds on their risk, equal risks on index
+class CRiskIndexLess
+{
+public:
+    CRiskIndexLess(const double *Risk) : m_Risk(Risk) {}
+    bool operator()(long a, long b) const
+    {
+        if (m_Risk[a] != m_Risk[b]) return m_Risk[a] < m_Risk[b];
+        return a < b;
+    }
+private:
+    const double *m_Risk;
+};
+
+/**
+ * Calculates the individual risk (see BaseIndividualRisk) of n combinations in one call.
+ * The pairs are grouped by the formula that applies (fk = 1, 2, 3 or more and Fk <= fk),
+ * every group is computed in a loop without branches. The results are equal to those of
+ * BaseIndividualRisk up to rounding.
+ * @param n         Number of combinations
+ * @param fkArray   Per combination the frequency fk
+ * @param FkArray   Per combination the total weight Fk
+ * @param RiskArray Per combination the risk, 0 <= risk <= 1
+ * @param Memoize   true: equal (fk, Fk) pairs are computed only once, useful if the weights repeat
+ * @return false if parameters are wrong (n < 0, or a pair with fk < 0 or Fk <= 0 with fk > 0);
+ * wrong pairs get risk 0 as with BaseIndividualRisk, the others are computed
+ */
+bool CMuArgCtrl::BaseIndividualRiskArray(long n, long *fkArray, double *FkArray, double *RiskArray, bool Memoize)
+{
+    long i, j, k;
+    bool ok = true;
+
+    if (n < 0) {
+        return false;
+    }
+
+    if (RISKMODEL != 2) {  // only the new risk model has formulas per fk
+        for (i = 0; i < n; i++) {
+            if (!BaseIndividualRisk(fkArray[i], FkArray[i], &RiskArray[i])) {
+                ok = false;
+            }
+        }
+        return ok;
+    }
+
+    // the pairs to compute, with Memoize the first one of equal pairs
+    std::vector<long> Index(n);
+    for (i = 0; i < n; i++) {
+        Index[i] = i;
+    }
+    if (Memoize) {
+        std::sort(Index.begin(), Index.end(), CRiskPairLess(fkArray, FkArray));
+    }
+
+    // per formula the pairs: 0 Fk <= fk, 1, 2, 3 fk, 4 fk > 3
+    std::vector<long> Class[5];
+    for (k = 0; k < n; k++) {
+        i = Index[k];
+        if (Memoize && k > 0 && fkArray[i] == fkArray[Index[k - 1]] && FkArray[i] == FkArray[Index[k - 1]]) {
+            continue;
+        }
+        if (fkArray[i] < 0 || (fkArray[i] > 0 && FkArray[i] <= 0)) {
+            RiskArray[i] = 0;  // wrong pair, see BaseIndividualRisk
+            ok = false;
+        }
+        else if (fkArray[i] == 0) {
+            RiskArray[i] = 0;  // no frequency, no risk
+        }
+        else if (FkArray[i] <= fkArray[i]) {
+            Class[0].push_back(i);
+        }
+        else {
+            Class[fkArray[i] > 3 ? 4 : fkArray[i]].push_back(i);
+        }
+    }
+
+    for (int c = 0; c < 5; c++) {
+        long m = Class[c].size();
+        if (m == 0) continue;
+        const long *ci = &Class[c][0];
+        std::vector<double> p(m), r(m);
+        for (j = 0; j < m; j++) {
+            p[j] = fkArray[ci[j]] / FkArray[ci[j]];
+        }
+        switch (c) {
+            case 0:
+                for (j = 0; j < m; j++) {
+                    r[j] = 1.0 / fkArray[ci[j]];
+                }
+                break;
+            case 1:
+                for (j = 0; j < m; j++) {
+                    double q = 1 - p[j];
+                    r[j] = - log (p[j]) * ( p[j] / q );
+                }
+                break;
+            case 2:
+                for (j = 0; j < m; j++) {
+                    double q = 1 - p[j];
+                    r[j] = ( p[j] * log(p[j]) + q) * p[j] / (q * q);
+                }
+                break;
+            case 3:
+                for (j = 0; j < m; j++) {
+                    double q = 1 - p[j];
+                    r[j] = p[j] * ( q * ( 3 * q - 2) - 2 * p[j] * p[j] * log(p[j]) ) / ( 2 * q * q * q);
+                }
+                break;
+            default:
+                for (j = 0; j < m; j++) {
+                    double q = 1 - p[j], x1 = 1, x2 = 1;
+                    long fk = fkArray[ci[j]];
+                    for (i = 1; i <= 7; i++) {
+                        x2 = x2 * i * q / (fk + i);
+                        x1 = x1 + x2;
+                    }
+                    r[j] = x1 * p[j] / fk;
+                }
+                break;
+        }
+        for (j = 0; j < m; j++) {
+            RiskArray[ci[j]] = r[j];
+        }
+    }
+
+    // copy the risk of the first one of equal pairs
+    if (Memoize) {
+        for (k = 1; k < n; k++) {
+            i = Index[k];
+            if (fkArray[i] == fkArray[Index[k - 1]] && FkArray[i] == FkArray[Index[k - 1]]) {
+                RiskArray[i] = RiskArray[Index[k - 1]];
+            }
+        }
+    }
+
+    return ok;
+}
+
 /**
  * Calculates all with SetTable specified tables from the data file and all subtables 
  * thereof, e.g., for table ABC also subtables AB, AC, BC, A, B and C.
@@ -907,17 +1124,13 @@ bool CMuArgCtrl::ComputeTables(long *ErrorCode, long *TableIndex)
 	}
     }
     // make space for households
+    m_BHRIndex.clear();
+    m_HH.Clear();
     if ((m_lNumberOfHH != 0) && (m_bHasBIR)) {
-        m_HH = new CHousehold [m_lNumberOfHH];
-	if (m_HH == 0) {
-            // Not enough memory
+        // the number of members of the households from the household index of ExploreFile
+        if (!m_HH.PrepareHouseholdBHR(m_lNumberOfHH, m_lNumBIRs, m_HHnRec)) {
             return false;
 	}
-	for (i= 0; i<m_lNumberOfHH; i++) {
-            if (!m_HH[i].PrepareHouseholdBHR(m_lNumBIRs)) {
-		return false;
-            }
-	}
     }
     fd = fopen(m_fname, "r");
     if (fd == 0) {
@@ -925,6 +1138,20 @@ bool CMuArgCtrl::ComputeTables(long *ErrorCode, long *TableIndex)
         return false;
     }
 
+    // keep the codes of the BIR variables of every record for the household risks
+    PrepareRecCodes();
+    if ((m_lNumberOfHH != 0) && (m_bHasBIR)) {
+        for (i = 0; i < m_ntab; i++) {
+            if (!m_tab[i].IsBIR) continue;
+            for (j = 0; j < m_tab[i].nDim; j++) {
+                if (std::find(m_RecVars.begin(), m_RecVars.end(), m_tab[i].Varnr[j]) == m_RecVars.end()) {
+                    m_RecVars.push_back(m_tab[i].Varnr[j]);
+                }
+            }
+        }
+        m_RecCodesValid = true;
+    }
+
     int recnr = 0;
     //hier gaat de SAS variant wel goed AHNL 30 maart 2005
     while (!feof(fd) ) {
@@ -945,79 +1172,58 @@ bool CMuArgCtrl::ComputeTables(long *ErrorCode, long *TableIndex)
 		}
 		else {
                     FillTables(str);
+                    if (m_RecCodesValid) {
+                        SaveRecCodes();
+                    }
                     break;
 		}
         }
     }
 
     oke:
-    // Once more to fill Households
-    if ((m_lNumberOfHH>0) && (m_bHasBIR)) {
-	rewind(fd);
-	int res;
-	if ((!m_InFileIsFixedFormat)&&(m_IgnoreFirstLine)) {
-            res = ReadMicroRecord(fd, str);
-	}
-
-	bool newhousehold = false;
-	long numberofmem = 0;
-	long HHnum = 0;
-	while (!feof(fd) ) {
-            res = ReadMicroRecord(fd, str);
-            if (++recnr % FIREPROGRESS == 0) {
-                FireUpdateProgress((int)(ftell(fd) * 100.0 / m_fSize));  // for progressbar in container
-            }
-            switch (res) {
-                case INFILE_ERROR:
-                    goto error;
-                    break;
-                case INFILE_EOF:
-                    m_HH[m_lNumberOfHH - 1].m_lNumberofMembers = numberofmem;
-                    goto oke1;
-                    break;
-		case INFILE_OKE:
-//                  if ((!m_InFileIsFixedFormat)&&(m_IgnoreFirstLine)&&(recnr == 1)) {
-//				continue;
-//			}
-//			else {
-				//Here find the number of members in a household
-                    newhousehold = IsNewHH(str);
-                    if (newhousehold) {
-                        m_HH[HHnum].m_lNumberofMembers= numberofmem;
-			numberofmem = 1;
-			HHnum++;
-                    }
-                    else {
-                        numberofmem ++;
-                    }
-                    break;
-//		}
-            }
-        }
-	m_HH[HHnum].m_lNumberofMembers= numberofmem;
-
-    }
-    else {
-	// should I close fd;
-    }
-
-    oke1:
     fclose(fd);
+    if (m_RecCodesValid && (long) m_RecCodeIndex.size() != (long) m_RecVars.size() * m_HH.m_MemberStart[m_HH.m_nHH]) {
+        PrepareRecCodes();  // records and households don't match, read the file again
+    }
 
     LastHHName = ""; CurrentHHName = "";
+    m_RecodeTablesValid = false;  // base tables are new
+    ComputeLevelTables(-1);
     ComputeSubTableList();
     return true;
 
     error:
     fclose(fd);
+    PrepareRecCodes();
     return false;
 }
 
-bool CMuArgCtrl::ComputeTableIndex(char *str, CVariable *var, long Index)
-{ 
-    char code[MAXCODEWIDTH];
+// no record codes kept
+void CMuArgCtrl::PrepareRecCodes()
+{
+    m_RecCodesValid = false;
+    std::vector<int>().swap(m_RecVars);
+    std::vector<int>().swap(m_RecCodeIndex);
+    std::vector<bool>().swap(m_RecCodeMissing);
+}
 
-    bool IsMissing;
+// keeps the code indices of the m_RecVars just computed by FillTables
+void CMuArgCtrl::SaveRecCodes()
+{
+    for (int i = 0; i < (int) m_RecVars.size(); i++) {
+        CVariable &var = m_var[m_RecVars[i]];
+        if (var.TableIndex < 0 || var.HasRecode) {
+            PrepareRecCodes();  // unknown code, read the file again
+            return;
+        }
+        m_RecCodeIndex.push_back(var.TableIndex);
+        m_RecCodeMissing.push_back(var.TableIsMissing);
+    }
+}
+
+// the code of variable var (number Index) in record str
+void CMuArgCtrl::ReadTableCode(char *str, CVariable *var, long Index, char *code)
+{ 
     std::string tempcode;
     if (m_InFileIsFixedFormat) {
         strncpy(code, (char *) &str[var->bPos], var->nPos);
@@ -1029,7 +1235,13 @@ bool CMuArgCtrl::ComputeTableIndex(char *str, CVariable *var, long Index)
             code[var->nPos] = 0;
 	}
     }
-    tempcode = code;
+}
+
+bool CMuArgCtrl::ComputeTableIndex(char *str, CVariable *var, long Index)
+{ 
+    char code[MAXCODEWIDTH];
+
+    ReadTableCode(str, var, Index, code);
     if (!(var->SetTableIndex(code))) {
         return false;
     }
@@ -1037,6 +1249,15 @@ bool CMuArgCtrl::ComputeTableIndex(char *str, CVariable *var, long Index)
     return true;
 }
 
+// as ComputeTableIndex, without changing var (so threads can share it)
+int CMuArgCtrl::ComputeTableIndex(char *str, CVariable *var, long Index, bool& IsMissing)
+{ 
+    char code[MAXCODEWIDTH];
+
+    ReadTableCode(str, var, Index, code);
+    return var->FindTableIndex(code, IsMissing);
+}
+
 void CMuArgCtrl::FillTables(char *str)
 { 
     int i, j;
@@ -1144,6 +1365,10 @@ int CMuArgCtrl::ComputeSubTableList()
     memset(m_unsafe, 0, sizeof(int) * (MAXDIM + 1));
     
     m_cuc = m_nUC = 0;
+    m_nPrunedUC = 0;
+    m_UCProfileValid = false;
+    m_BIRCellsValid = false;
+    ClearRecodedTablesCache();
 
     // first compute number of (sub)tables
     for (i = 0; i < m_ntab; i++) {
@@ -1168,6 +1393,7 @@ int CMuArgCtrl::ComputeSubTableList()
     }
     assert(m_cuc <= m_nUC);
     m_nUC = m_cuc;
+    BuildUCIndex();
 
     // compute max dim
     maxdim = 0;
@@ -1177,6 +1403,15 @@ int CMuArgCtrl::ComputeSubTableList()
 	}
     }
 
+    // smallest non-zero cell of the base tables
+    for (i = 0; i < m_nUC; i++) {
+        CUCList *u = &(m_UCList[i]);
+        u->Pruned = false;
+        if (u->nDim == m_tab[u->TabNr].nDim) {
+            u->MinFreq = ComputeMinFreq(m_tab[u->TabNr]);
+        }
+    }
+
     CTable t;
     int nTables = 0;
     // compute subtables
@@ -1185,36 +1420,7 @@ int CMuArgCtrl::ComputeSubTableList()
             CUCList *u = &(m_UCList[i]);     // for easier and faster reference
             if (u->nDim != dim) continue;
             if (dim == m_tab[u->TabNr].nDim) continue;
-            // fill subtable data
-            t.nDim = dim;
-            for (int j = 0; j < dim; j++) {
-                t.Varnr[j] = u->Varnr[j];
-                t.SizeDim[j] = m_var[t.Varnr[j]].GetnCodes(true);
-            }
-            t.Threshold = u->Threshold;
-            t.BaseTable = false;
-            // find a table with one dimension more that contains the same variables
-            for (int k = 0; k < m_nUC; k++) {
-                if (dim + 1 != m_UCList[k].nDim) continue;
-                if (dim + 1 == m_tab[m_UCList[k].TabNr].nDim) {  // basis table is a permanent table
-                    if (ComputeSubTable(m_tab[m_UCList[k].TabNr], t) > 0)  {
-                        FireUpdateProgress( (int) (++nTables * 100.0 / m_nUC));
-                        break;
-                    }
-                }
-                else {
-                    if (dim + 1 == m_UCList[k].nDim) {             // basis table is a subtable
-                        if (ComputeSubTable(m_UCList[k].table, t) > 0)  {  // an earlier computed table
-                            break;
-                        }
-                    }
-                }
-            }
-            //assert(k < m_nUC); // table created
-            assert(m_UCList[i].nDim > 0 &&  m_UCList[i].nDim <= MAXDIM);
-            m_unsafe[0][m_UCList[i].nDim] = 0;
-            m_UCList[i].table = t;  // save table in UCList
-            m_UCList[i].nUC = m_unsafe[0][m_UCList[i].nDim]; // not for every code
+            ComputeUCListTable(i, maxdim, t, nTables, -1);
         }
     }
 
@@ -1223,37 +1429,161 @@ int CMuArgCtrl::ComputeSubTableList()
 
     // compute unsafe cells in m_unsafe for every table
     for (i = 0; i < m_nUC; i++) {
-        CUCList *u = &(m_UCList[i]);
-        m_unsafe[0][u->nDim] = 0;
-	if (u->nDim == m_tab[u->TabNr].nDim) { // base table
-            ComputeUnsafeCells(m_tab[u->TabNr], -1);
-	}
-	else {
-            ComputeUnsafeCells(u->table, -1);
-	}
-	u->nUC = m_unsafe[0][u->nDim]; // not for every code
+        ComputeUCListUnsafe(i);
+        if (m_UCList[i].Pruned) {
+            m_nPrunedUC++;
+        }
     }
     // sort UCList on identical variable combinations,
     // equals have largest threshold first
     SortUCList(m_nUC, m_UCList);
+    BuildUCIndex();
 
-    CUCList temp = m_UCList[0];
-    m_UCList[0].biggestThreshold = true;
-    for (i = 1; i < m_nUC; i++)
-    {
-        while (i < m_nUC && CompareUCList(temp, m_UCList[i]) == 0) {
-            m_UCList[i].biggestThreshold = false;
-            i++;
-	}
-	if (i <m_nUC)
-	{
-            temp = m_UCList[i];
-            m_UCList[i].biggestThreshold = true;
-	}
+    int first = 0;
+    for (i = 0; i < m_nUC; i++) {
+        m_UCList[i].biggestThreshold = (i == 0 || CompareUCList(m_UCList[first], m_UCList[i]) != 0);
+        if (m_UCList[i].biggestThreshold) {
+            first = i;
+            m_UCDimList[m_UCList[i].nDim].push_back(i);
+        }
+    }
+
+    // recode versions the (sub)tables are computed for, see ApplyRecode
+    m_RecodedTablesCache.resize(m_ntab);
+    m_TabStash.resize(m_ntab);
+    m_TabRestore.resize(m_ntab);
+    m_TabVersion.assign(m_ntab * MAXDIM, 0);
+    for (i = 0; i < m_ntab; i++) {
+        if (m_tab[i].HasRecode) {
+            GetTableRecodeVersion(i, &m_TabVersion[i * MAXDIM]);
+        }
     }
     return maxdim;
 }
 
+// computes the subtable of entry i of m_UCList out of a table with one dimension more,
+// MinFreq and Pruned included
+// IsBIR >= 0: take a table with the same IsBIR as source if there is one
+void CMuArgCtrl::ComputeUCListTable(int i, int maxdim, CTable &t, int &nTables, int IsBIR)
+{
+    CUCList *u = &(m_UCList[i]);     // for easier and faster reference
+    int dim = u->nDim;
+
+    // tables with one dimension more that contain the same variables:
+    // add one variable to the combination and look it up.
+    // A cell of a subtable is at least as big as every cell it aggregates,
+    // so if such a table has no non-zero cell <= Threshold
+    // (missings included), the subtable has none either
+    int k, d, v, src = m_nUC, srcBIR = m_nUC;
+    int supvars[MAXDIM];
+    u->MinFreq = 0;
+    for (v = 0; v < m_nvar; v++) {
+        int j, n = 0;
+        for (j = 0; j < dim; j++) {
+            if (u->Varnr[j] == v) break;
+            if (u->Varnr[j] < v) supvars[n++] = u->Varnr[j];
+        }
+        if (j < dim) continue;  // v already in subtable
+        supvars[n++] = v;
+        for (j = 0; j < dim; j++) {
+            if (u->Varnr[j] > v) supvars[n++] = u->Varnr[j];
+        }
+        for (k = FindUCList(dim + 1, supvars); k >= 0; k = m_UCNext[k]) {
+            CUCList *w = &(m_UCList[k]);
+            bool base = (dim + 1 == m_tab[w->TabNr].nDim);
+            if (w->MinFreq > u->MinFreq) {
+                u->MinFreq = w->MinFreq;
+            }
+            if (!base && w->table.Cell == 0) continue;  // subtable not computed
+            if (k < src) {
+                src = k;   // first one in UCList, a permanent table or a computed subtable
+            }
+            if (k < srcBIR && (base ? m_tab[w->TabNr].IsBIR : w->table.IsBIR) == (IsBIR > 0)) {
+                srcBIR = k;
+            }
+        }
+    }
+    if (IsBIR >= 0 && srcBIR < m_nUC) {
+        src = srcBIR;
+    }
+    u->Pruned = (u->MinFreq > u->Threshold);
+
+    // fill subtable data
+    t.nDim = dim;
+    for (int j = 0; j < dim; j++) {
+        t.Varnr[j] = u->Varnr[j];
+        t.SizeDim[j] = m_var[t.Varnr[j]].GetnCodes(true);
+    }
+    t.Threshold = u->Threshold;
+    t.BaseTable = false;
+
+    // one dimensional and BIR tables are still needed for entropy and missing aggregation
+    if (u->Pruned && m_SkipPrunedTables && dim > 1 && !m_tab[u->TabNr].IsBIR) {
+        t.Cell = 0;
+        t.nCell = 0;
+        t.IsBIR = false;
+        t.BIRCell = 0;
+        u->table = t;
+        return;
+    }
+
+    if (src < m_nUC) {
+        if (dim + 1 == m_tab[m_UCList[src].TabNr].nDim) {  // basis table is a permanent table
+            if (ComputeSubTable(m_tab[m_UCList[src].TabNr], t) > 0)  {
+                FireUpdateProgress( (int) (++nTables * 100.0 / m_nUC));
+            }
+        }
+        else {
+            ComputeSubTable(m_UCList[src].table, t);  // an earlier computed table
+        }
+    }
+    else {
+        // all tables with one dimension more are skipped subtables without cells,
+        // find a table with the fewest dimensions more that contains the same variables
+        for (d = dim + 2; d <= maxdim; d++) {
+            for (k = 0; k < m_nUC; k++) {
+                if (d != m_UCList[k].nDim) continue;
+                if (d == m_tab[m_UCList[k].TabNr].nDim) {  // basis table is a permanent table
+                    if (ComputeSubTable(m_tab[m_UCList[k].TabNr], t) > 0)  {
+                        FireUpdateProgress( (int) (++nTables * 100.0 / m_nUC));
+                        break;
+                    }
+                }
+                else {
+                    if (m_UCList[k].table.Cell == 0) continue;     // subtable not computed
+                    if (ComputeSubTable(m_UCList[k].table, t) > 0)  {  // an earlier computed table
+                        break;
+                    }
+                }
+            }
+            if (k < m_nUC) break;
+        }
+    }
+    //assert(k < m_nUC); // table created
+    assert(u->nDim > 0 &&  u->nDim <= MAXDIM);
+    u->table = t;  // save table in UCList
+    u->MinFreq = ComputeMinFreq(u->table);
+}
+
+// computes nUC of entry i of m_UCList
+void CMuArgCtrl::ComputeUCListUnsafe(int i)
+{
+    CUCList *u = &(m_UCList[i]);
+
+    m_unsafe[0][u->nDim] = 0;
+    if (u->Pruned) {  // provably safe, no need to count
+        u->nUC = 0;
+        return;
+    }
+    if (u->nDim == m_tab[u->TabNr].nDim) { // base table
+        ComputeUnsafeCells(m_tab[u->TabNr], -1);
+    }
+    else {
+        ComputeUnsafeCells(u->table, -1);
+    }
+    u->nUC = m_unsafe[0][u->nDim]; // not for every code
+}
+
 void CMuArgCtrl::DoSubTableList(int iTab, int niv, int from, int *vars, int CVar)
 {
     int i, j;
@@ -1437,17 +1767,116 @@ void CMuArgCtrl::ComputeNumberUnsafeCells(CTable & t, int niv, int cindex, bool
     }
 }
 
-void CMuArgCtrl::SortUCList(int n, CUCList *uc)
+// computes for every variable in a table, for each code and dimension, the number of unsafe cells
+// in one pass over the biggestThreshold tables. Same counts as ComputeUnsafeCells(t, v) per variable.
+// m_UCProfile holds per variable nCodes * (MAXDIM + 1) numbers, the first one of a code is its freq
+bool CMuArgCtrl::ComputeUnsafeProfile()
+{
+    int i, j, v;
+    long size = 0;
+
+    if (m_UCProfileValid) {
+        return true;
+    }
+
+    m_UCProfileStart.assign(m_nvar, 0);
+    m_UCProfileMaxDim.assign(m_nvar, 0);
+    for (v = 0; v < m_nvar; v++) {
+        m_UCProfileStart[v] = size;
+        if (m_var[v].IsCategorical) {
+            size += (long) m_var[v].GetnCodes(true) * (MAXDIM + 1);
+        }
+    }
+    m_UCProfile.assign(size, 0);
+
+    for (i = 0; i < m_nUC; i++) {
+        CUCList *ul = &(m_UCList[i]);
+        if (!ul->biggestThreshold) continue;
+        for (j = 0; j < ul->nDim; j++) {
+            v = ul->Varnr[j];
+            if (ul->nDim > m_UCProfileMaxDim[v]) {
+                m_UCProfileMaxDim[v] = ul->nDim;
+            }
+        }
+        if (ul->Pruned && ul->nDim > 1) continue;  // no unsafe cells, no freqs
+        int codes[MAXDIM];
+        if (ul->nDim == m_tab[ul->TabNr].nDim) { // basetable
+            ComputeUnsafeProfileCells(m_tab[ul->TabNr], 0, 0, false, codes);
+        }
+        else {
+            ComputeUnsafeProfileCells(ul->table, 0, 0, false, codes);
+        }
+    }
+
+    m_UCProfileValid = true;
+    return true;
+}
+
+void CMuArgCtrl::ComputeUnsafeProfileCells(CTable & t, int niv, int cindex, bool IsMissingCode, int *codes)
+{
+    int i;
+
+    if (niv == t.nDim) {
+        assert(cindex >= 0 && cindex < t.nCell);
+        if (t.Cell[cindex] <= t.Threshold && t.Cell[cindex] != 0 && !IsMissingCode) {
+            for (i = 0; i < t.nDim; i++) {
+                m_UCProfile[m_UCProfileStart[t.Varnr[i]] + codes[i] * (MAXDIM + 1) + niv]++;
+            }
+        }
+        if (t.nDim == 1) {  // save freq
+            m_UCProfile[m_UCProfileStart[t.Varnr[0]] + codes[0] * (MAXDIM + 1)] = t.Cell[cindex];
+        }
+        return;
+    }
+
+    int v = t.Varnr[niv];
+    int n, NMis;
+
+    // compute number of codes of variable v, can be recoded!
+    n = m_var[v].GetnCodes(true);
+    if (m_var[v].HasRecode) {
+        NMis = n - m_var[v].Recode.nMissing;
+    }
+    else {
+        NMis = n - m_var[v].nMissing;
+    }
+
+    for (i = 0; i < n; i++) {
+        codes[niv] = i;
+        ComputeUnsafeProfileCells(t, niv + 1, cindex * t.SizeDim[niv] + i, (i >= NMis) || IsMissingCode, codes);
+    }
+}
+
+// sorts the keys of uc, then puts uc in that order
+void CMuArgCtrl::SortUCList(int n, CUCList *&uc)
 {
-    if (n > 1) {
-        QuickSortUCList(uc, 0, n - 1);
+    int i;
+
+    if (n <= 1) {
+        return;
+    }
+
+    CUCKey *key = new CUCKey[n];
+    for (i = 0; i < n; i++) {
+        memcpy(key[i].Varnr, uc[i].Varnr, sizeof(key[i].Varnr));
+        key[i].Threshold = uc[i].Threshold;
+        key[i].Index = i;
+    }
+    QuickSortUCList(key, 0, n - 1);
+
+    CUCList *sorted = new CUCList[n];
+    for (i = 0; i < n; i++) {
+        sorted[i] = uc[key[i].Index];
     }
+    delete [] key;
+    delete [] uc;
+    uc = sorted;
 }
 
-void CMuArgCtrl::QuickSortUCList(CUCList *s, int first, int last)
+void CMuArgCtrl::QuickSortUCList(CUCKey *s, int first, int last)
 {
     int i, j;
-    CUCList mid, temp;
+    CUCKey mid, temp;
 
     assert(first >= 0 && last >= first);
 
@@ -1487,7 +1916,7 @@ void CMuArgCtrl::QuickSortUCList(CUCList *s, int first, int last)
     } while (first < last);
 }
 
-int CMuArgCtrl::CompareUCListThres(CUCList& a, CUCList& b)
+int CMuArgCtrl::CompareUCListThres(CUCKey& a, CUCKey& b)
 {
     int v;
 
@@ -1502,6 +1931,76 @@ int CMuArgCtrl::CompareUCList(CUCList& a, CUCList& b)
     return memcmp(a.Varnr, b.Varnr, sizeof(a.Varnr) );
 }
 
+int CMuArgCtrl::HashUCVars(int nDim, const int *Varnr)
+{
+    unsigned int h = nDim;
+
+    for (int i = 0; i < nDim; i++) {
+        h = h * 31 + Varnr[i];
+    }
+    return (int) (h & (m_UCHash.size() - 1));
+}
+
+// (re)builds the hash index on the variable combinations of m_UCList
+// equal combinations are chained in the order of m_UCList
+void CMuArgCtrl::BuildUCIndex()
+{
+    int i, h, size = 16;
+
+    while (size < 2 * m_nUC) {
+        size <<= 1;
+    }
+    m_UCHash.assign(size, -1);
+    m_UCNext.assign(m_nUC, -1);
+    for (i = 0; i <= MAXDIM; i++) {
+        m_UCDimList[i].clear();
+    }
+
+    for (i = m_nUC - 1; i >= 0; i--) {  // backwards: the chain starts with the first one
+        CUCList *u = &(m_UCList[i]);
+        h = HashUCVars(u->nDim, u->Varnr);
+        while (m_UCHash[h] >= 0) {
+            CUCList *w = &(m_UCList[m_UCHash[h]]);
+            if (w->nDim == u->nDim && memcmp(w->Varnr, u->Varnr, sizeof(int) * u->nDim) == 0) {
+                m_UCNext[i] = m_UCHash[h];
+                break;
+            }
+            h = (h + 1) & (size - 1);
+        }
+        m_UCHash[h] = i;
+    }
+}
+
+// returns the first index in m_UCList with this variable combination, -1 if not present
+int CMuArgCtrl::FindUCList(int nDim, const int *Varnr)
+{
+    int h;
+
+    if (m_UCHash.empty()) {
+        return -1;
+    }
+    for (h = HashUCVars(nDim, Varnr); m_UCHash[h] >= 0; h = (h + 1) & (m_UCHash.size() - 1)) {
+        CUCList *u = &(m_UCList[m_UCHash[h]]);
+        if (u->nDim == nDim && memcmp(u->Varnr, Varnr, sizeof(int) * nDim) == 0) {
+            return m_UCHash[h];
+        }
+    }
+    return -1;
+}
+
+// smallest non-zero cell of a table, INT_MAX if all cells are zero
+int CMuArgCtrl::ComputeMinFreq(CTable& t)
+{
+    int i, min = INT_MAX;
+
+    for (i = 0; i < t.nCell; i++) {
+        if (t.Cell[i] != 0 && t.Cell[i] < min) {
+            min = t.Cell[i];
+        }
+    }
+    return min;
+}
+
 /**
  * Calculates the maximum number nUC of the permanent (sub)tables
  * @return long Maximum number nUC of the permanent (sub)tables
@@ -1630,10 +2129,15 @@ bool CMuArgCtrl::UnsafeVariablePrepare(long VarIndex, long *nCode)
     // Now try to find for variable 'v'
     // for all dims and all codes of 'v' the unsafe combinations
     // save results in m_unsafe[nCode][MAXDIM + 1]
+    // they are computed for all variables at once and kept until the tables change
     CVariable *var;
     var = &(m_var[v]);
     nCodes = var->GetnCodes(true);
 
+    if (!ComputeUnsafeProfile()) {
+        return false;
+    }
+
     if (m_unsafe != 0) {
         delete [] m_unsafe;
 	m_unsafe = 0;
@@ -1644,28 +2148,11 @@ bool CMuArgCtrl::UnsafeVariablePrepare(long VarIndex, long *nCode)
 	// Not too sure about this
 	return false;
     }
-    memset(m_unsafe, 0, sizeof(int) * (MAXDIM  + 1) * nCodes);
-
-    m_maxdim = 0;
-    for (i = 0; i < m_nUC; i++) {
-        CUCList *ul = &(m_UCList[i]);
-	if (!ul->biggestThreshold) continue;
-	int n = ul->nDim;
-	for (j = 0; j < n; j++) {
-            if (ul->Varnr[j] == v) {
-                if (n == m_tab[ul->TabNr].nDim) { // basetable
-                    ComputeUnsafeCells(m_tab[ul->TabNr], v);
-		}
-                else {
-                    ComputeUnsafeCells(ul->table, v);
-		}
-		if (n > m_maxdim) {
-                    m_maxdim = n;
-		}
-		break;
-            }
-	}
+    if (nCodes > 0) {
+        memcpy(m_unsafe, &m_UCProfile[m_UCProfileStart[v]], sizeof(int) * (MAXDIM  + 1) * nCodes);
     }
+    m_maxdim = m_UCProfileMaxDim[v];
+
     var = &(m_var[v]);
     *nCode = var->GetnCodes(true);
     return true;
@@ -1754,6 +2241,414 @@ bool CMuArgCtrl::UnsafeVariableClose(long VarIndex)
     return true;
 }
 
+/**
+ * Provides for all codes of a variable at once what UnsafeVariableCodes provides for one code
+ * UnsafeVariablePrepare is not needed
+ * @param VarIndex      Index of variable
+ * @param nCodes        Number of elements in MissingArray and FreqArray, at least the number of codes
+ *                      (including missings) of the variable. UCArray has nCodes * MAXDIM elements
+ * @param MissingArray  Per code 1 if Missing code, 0 otherwise
+ * @param FreqArray     Per code the frequency
+ * @param Count         Number of dimensions in UCArray per code
+ * @param UCArray       Per code MAXDIM elements, the UCs of dimensions 1, 2, ..., Count
+ * @param CodeString    All alphanumeric codes, separated by a newline character
+ * @return false if one or more parameters is wrong
+ */
+bool CMuArgCtrl::UnsafeVariableAllCodes(long VarIndex, long nCodes, long *MissingArray, long *FreqArray, long *Count, long *UCArray, const char **CodeString)
+{
+    int v = VarIndex - 1;
+    int c, i, n, nValid;
+
+    // Not the right moment, first call SetNumberVar
+    if (m_nvar == 0 || m_ntab == 0) {
+	return false;
+    }
+
+    // VarIndex correct?
+    if (v < 0 || v >= m_nvar || !m_var[v].IsCategorical) {
+	return false;
+    }
+
+    n = m_var[v].GetnCodes(true);
+    if (nCodes < n) {
+	return false;
+    }
+
+    if (!ComputeUnsafeProfile()) {
+	return false;
+    }
+
+    nValid = m_var[v].GetnCodes(false);
+    const int *profile = &m_UCProfile[m_UCProfileStart[v]];
+    *Count = m_UCProfileMaxDim[v];
+    m_CodeString.clear();
+    for (c = 0; c < n; c++) {
+        MissingArray[c] = (c >= nValid) ? 1 : 0;
+        FreqArray[c] = profile[0]; // 'zero' dimension = freq
+        for (i = 1; i <= MAXDIM; i++) {
+            UCArray[c * MAXDIM + i - 1] = (i <= *Count) ? profile[i] : 0;
+        }
+        profile += MAXDIM + 1;
+
+        if (c > 0) {
+            m_CodeString += "\n";
+        }
+        if (m_var[v].HasRecode) {
+            m_CodeString += m_var[v].Recode.sCode[c];
+        }
+        else {
+            m_CodeString += m_var[v].sCode[c];
+        }
+    }
+    *CodeString = m_CodeString.c_str();
+
+    return true;
+}
+
+/**
+ * Provides for all codes of a variable what GetVarCode provides for one code
+ * @param VarIndex      Index of variable
+ * @param nCodes        Number of elements in PramPercArray, at least the number of codes (without missings)
+ * @param CodeString    All alphanumeric codes, separated by a newline character
+ * @param PramPercArray Per code the Pram percentage, -1 if not prammed
+ * @return false if one or more parameters is wrong
+ */
+bool CMuArgCtrl::GetVarCodes(long VarIndex, long nCodes, const char **CodeString, long *PramPercArray)
+{
+    int v = VarIndex - 1, c, n;
+
+    if (v < 0 || v >= m_nvar || !m_var[v].IsCategorical)	{
+	return false;
+    }
+
+    n = m_var[v].GetnCodes(false);
+    if (nCodes < n)	{
+	return false;
+    }
+
+    m_CodeString.clear();
+    for (c = 0; c < n; c++) {
+        if (c > 0) {
+            m_CodeString += "\n";
+        }
+        if (m_var[v].HasRecode) {
+            m_CodeString += m_var[v].Recode.sCode[c];
+        } else {
+            m_CodeString += m_var[v].sCode[c];
+        }
+
+        if (m_var[v].HasPram) {
+            PramPercArray[c] = m_var[v].PramValue[c];
+        } else {
+            PramPercArray[c] = -1;
+        }
+    }
+    *CodeString = m_CodeString.c_str();
+
+    return true;
+}
+
+/**
+ * Evaluates several candidate recodings of a variable without applying them.
+ * Each candidate is checked and computed as in DoRecode, the base tables are
+ * recoded with it (other variables keep their current recode) and the
+ * unsafe combinations are counted as UnsafeVariable would after DoRecode and ApplyRecode.
+ * The current recodes and tables are not changed. Candidates are evaluated in parallel
+ * if compiled with OpenMP.
+ * @param VarIndex          Index of variable
+ * @param nCandidates       Number of candidate recodings
+ * @param RecodeStrings     nCandidates recode specifications, see DoRecode
+ * @param eMissing1         Value of Missing1 for all candidates
+ * @param eMissing2         Value of Missing2 for all candidates
+ * @param ErrorTypeArray    Per candidate the error type of the recode, -1 if correct
+ * @param nCodeArray        Per candidate the number of codes after recoding (missings included), -1 if wrong
+ * @param Count             Number of dimensions in UCArray per candidate
+ * @param UCArray           nCandidates * MAXDIM (10) numbers, for candidate c the UCs of dimensions 1, 2, ..., Count
+ *                          start at c * MAXDIM
+ * @return false if one or more parameters is wrong or the tables are not computed
+ */
+bool CMuArgCtrl::EvaluateRecodes(long VarIndex, long nCandidates, char *RecodeStrings[], const char *eMissing1, const char *eMissing2, long *ErrorTypeArray, long *nCodeArray, long *Count, long *UCArray)
+{
+    int v = VarIndex - 1, j, ndim;
+    long c;
+
+    // too early?
+    if (m_nvar == 0 || m_ntab == 0 || m_fname[0] == 0 || m_UCList == 0) {
+        return false;
+    }
+    if (v < 0 || v >= m_nvar || !m_var[v].IsCategorical || nCandidates < 1) {
+        return false;
+    }
+
+    // dimensions as in UnsafeVariable
+    *Count = 0;
+    for (ndim = 1; ndim < MAXDIM; ndim++) {
+        bool tabsfound = false;
+        for (j = 0; j < (int) m_UCDimList[ndim].size() && !tabsfound; j++) {
+            CUCList *u = &(m_UCList[m_UCDimList[ndim][j]]);
+            for (int k = 0; k < ndim; k++) {
+                if (u->Varnr[k] == v) {
+                    tabsfound = true;
+                    break;
+                }
+            }
+        }
+        if (!tabsfound) break;
+        *Count = ndim;
+    }
+    if (*Count == 0) {
+        return false;  // Variable not present in any table
+    }
+
+    // compute the recodes one after the other in m_var[v].Recode, keep the current one aside
+    std::vector< std::vector<int> > DestCode(nCandidates);
+    std::vector<int> nMissing(nCandidates, 0);
+    RECODE SavedRecode = m_var[v].Recode;
+    bool SavedHasRecode = m_var[v].HasRecode;
+    std::string SavedWarning = m_WarningRecode;
+
+    for (c = 0; c < nCandidates; c++) {
+        long ErrorLine, ErrorPos;
+        ErrorTypeArray[c] = -1;
+        nCodeArray[c] = -1;
+        if (RecodeStrings[c] == 0) {
+            ErrorTypeArray[c] = E_EMPTYSPEC;
+            continue;
+        }
+        m_var[v].Recode.DestCode = 0;
+        m_var[v].HasRecode = false;
+        if (MakeRecode(v, RecodeStrings[c], eMissing1, eMissing2, &ErrorTypeArray[c], &ErrorLine, &ErrorPos)) {
+            nCodeArray[c] = m_var[v].Recode.nCode;
+            nMissing[c] = m_var[v].Recode.nMissing;
+            DestCode[c].assign(m_var[v].Recode.DestCode, m_var[v].Recode.DestCode + m_var[v].nCode);
+        }
+        if (m_var[v].Recode.DestCode != 0) {
+            free(m_var[v].Recode.DestCode);
+        }
+    }
+    m_var[v].Recode = SavedRecode;
+    m_var[v].HasRecode = SavedHasRecode;
+    m_WarningRecode = SavedWarning;
+
+    memset(UCArray, 0, sizeof(long) * nCandidates * MAXDIM);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (c = 0; c < nCandidates; c++) {
+        if (nCodeArray[c] < 0) continue;
+        EvaluateRecodeCandidate(v, &DestCode[c][0], nCodeArray[c], nMissing[c], &UCArray[c * MAXDIM]);
+    }
+    return true;
+}
+
+/**
+ * Searches a global recode of a variable by merging adjacent codes, such that few unsafe
+ * combinations are left and little information is lost. Starting with the original codes
+ * (the current recode of the variable is not used), each step merges two adjacent groups of codes.
+ * A beam search keeps the BeamWidth groupings with the lowest cost after every step,
+ * BeamWidth = 1 gives a greedy search. The cost of a grouping is the number of unsafe
+ * combinations (all dimensions, as in UnsafeVariable) plus LossWeight times the loss of entropy
+ * in bits. The search stops when a grouping without unsafe combinations is found, after MaxSteps
+ * merges or when nothing is left to merge. The cells of the tables are merged in memory, the
+ * data file is not read and nothing of the session is changed. Other variables keep their current recode,
+ * for more variables search and apply (DoRecode, ApplyRecode) them one after the other.
+ * @param VarIndex          Index of variable
+ * @param MaxSteps          Maximum number of merges, 0 for no maximum
+ * @param BeamWidth         Number of groupings kept after every step
+ * @param LossWeight        Weight of the entropy loss against the number of unsafe combinations
+ * @param nCode             Number of codes of the grouping with the lowest cost found, missings not included
+ * @param nUnsafe           Number of unsafe combinations of this grouping
+ * @param EntropyLoss       Entropy loss of this grouping in bits
+ * @param RecodeString      Recode specification of this grouping for DoRecode, merged codes get the first code
+ *                          of their group, other codes are untouched
+ * @return false if one or more parameters is wrong, the tables are not computed or the variable is not in a table
+ */
+bool CMuArgCtrl::SearchRecode(long VarIndex, long MaxSteps, long BeamWidth, double LossWeight, long *nCode, long *nUnsafe, double *EntropyLoss, const char **RecodeString)
+{
+    int v = VarIndex - 1, c, g;
+    long m, step;
+
+    // too early?
+    if (m_nvar == 0 || m_ntab == 0 || m_fname[0] == 0 || m_UCList == 0) {
+        return false;
+    }
+    if (v < 0 || v >= m_nvar || !m_var[v].IsCategorical || MaxSteps < 0 || BeamWidth < 1 || LossWeight < 0) {
+        return false;
+    }
+
+    std::vector<CRecodeSearchTable> Tables;
+    std::vector<double> Freq;
+    if (!PrepareRecodeSearch(v, Tables, Freq)) {
+        return false;
+    }
+    int n = Freq.size();
+    double N = 0, Entropy = GroupEntropy(Freq);
+    long nRest = 0;
+    for (c = 0; c < n; c++) {
+        N += Freq[c];
+    }
+    for (c = 0; c < (int) Tables.size(); c++) {
+        nRest += Tables[c].nRest;
+    }
+
+    // start with every code in a group of its own
+    std::vector<int> First(n);
+    for (c = 0; c < n; c++) {
+        First[c] = c;
+    }
+    std::vector<CRecodeSearchState> Beam(1);
+    MakeRecodeSearchState(Tables, Freq, First, Beam[0]);
+    SetRecodeSearchCost(Beam[0], Entropy, LossWeight);
+    std::vector<int> BestFirst = Beam[0].First;
+    long BestUnsafe = Beam[0].nUnsafe;
+    double BestLoss = Beam[0].Loss, BestCost = Beam[0].Cost;
+    bool found = (BestUnsafe == 0);
+
+    for (step = 0; !found && (MaxSteps == 0 || step < MaxSteps); step++) {
+        // all merges of two adjacent groups in the groupings of the beam
+        std::vector<int> MoveState, MoveGroup;
+        for (c = 0; c < (int) Beam.size(); c++) {
+            for (g = 0; g + 1 < (int) Beam[c].First.size(); g++) {
+                MoveState.push_back(c);
+                MoveGroup.push_back(g);
+            }
+        }
+        long nMoves = MoveState.size();
+        if (nMoves == 0) break;  // all codes in one group
+
+        std::vector<long> MoveUnsafe(nMoves);
+        std::vector<double> MoveLoss(nMoves), MoveCost(nMoves);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if (nMoves * nRest >= PARALLELMINCELLS)
+#endif
+        for (m = 0; m < nMoves; m++) {
+            const CRecodeSearchState &s = Beam[MoveState[m]];
+            double a = s.Freq[MoveGroup[m]], b = s.Freq[MoveGroup[m] + 1];
+            MoveUnsafe[m] = s.nUnsafe + MergeUnsafeDelta(Tables, s, MoveGroup[m]);
+            MoveLoss[m] = s.Loss;
+            if (a > 0 && b > 0) {
+                MoveLoss[m] += ((a + b) * log(a + b) - a * log(a) - b * log(b)) / (N * log(2.0));
+            }
+            MoveCost[m] = MoveUnsafe[m] + LossWeight * MoveLoss[m];
+        }
+
+        // the cheapest different groupings
+        std::vector<long> Chosen;
+        std::vector< std::vector<int> > ChosenFirst;
+        std::vector<bool> Taken(nMoves, false);
+        while ((long) Chosen.size() < BeamWidth) {
+            long best = -1;
+            for (m = 0; m < nMoves; m++) {
+                if (!Taken[m] && (best < 0 || MoveCost[m] < MoveCost[best])) {
+                    best = m;
+                }
+            }
+            if (best < 0) break;
+            Taken[best] = true;
+            std::vector<int> f = Beam[MoveState[best]].First;
+            f.erase(f.begin() + MoveGroup[best] + 1);
+            if (std::find(ChosenFirst.begin(), ChosenFirst.end(), f) != ChosenFirst.end()) {
+                continue;  // same grouping by other merges
+            }
+            Chosen.push_back(best);
+            ChosenFirst.push_back(f);
+        }
+
+        // make them, a grouping used for the last time is merged in place
+        std::vector<int> nUse(Beam.size(), 0);
+        for (c = 0; c < (int) Chosen.size(); c++) {
+            nUse[MoveState[Chosen[c]]]++;
+        }
+        std::vector<CRecodeSearchState> NewBeam(Chosen.size());
+        for (c = 0; c < (int) Chosen.size(); c++) {
+            int b = MoveState[Chosen[c]];
+            if (--nUse[b] == 0) {
+                NewBeam[c].Swap(Beam[b]);
+            }
+            else {
+                NewBeam[c] = Beam[b];
+            }
+            MergeRecodeGroups(Tables, NewBeam[c], MoveGroup[Chosen[c]]);
+            SetRecodeSearchCost(NewBeam[c], Entropy, LossWeight);
+            if (NewBeam[c].Cost < BestCost) {
+                BestFirst = NewBeam[c].First;
+                BestUnsafe = NewBeam[c].nUnsafe;
+                BestLoss = NewBeam[c].Loss;
+                BestCost = NewBeam[c].Cost;
+            }
+            if (NewBeam[c].nUnsafe == 0) {
+                found = true;  // merging more only loses information
+            }
+        }
+        Beam.swap(NewBeam);
+    }
+
+    *nCode = BestFirst.size();
+    *nUnsafe = BestUnsafe;
+    *EntropyLoss = BestLoss;
+    m_SearchRecodeString = MakeGroupRecodeString(v, BestFirst);
+    *RecodeString = m_SearchRecodeString.c_str();
+    return true;
+}
+
+/**
+ * Searches the truncation of a variable (see DoTruncate) with the lowest cost: the number of
+ * unsafe combinations (all dimensions, as in UnsafeVariable) plus LossWeight times the loss of
+ * entropy in bits. Every number of positions is evaluated by merging the cells of the tables in
+ * memory, the data file is not read and nothing of the session is changed.
+ * Other variables keep their current recode.
+ * @param VarIndex          Index of variable
+ * @param LossWeight        Weight of the entropy loss against the number of unsafe combinations
+ * @param nPos              Number of positions to truncate with the lowest cost, 0 if not truncating is best
+ * @param nUnsafe           Number of unsafe combinations of this truncation
+ * @param EntropyLoss       Entropy loss of this truncation in bits
+ * @return false if one or more parameters is wrong, the tables are not computed or the variable is not in a table
+ */
+bool CMuArgCtrl::SearchTruncate(long VarIndex, double LossWeight, long *nPos, long *nUnsafe, double *EntropyLoss)
+{
+    int v = VarIndex - 1, c, t;
+
+    // too early?
+    if (m_nvar == 0 || m_ntab == 0 || m_fname[0] == 0 || m_UCList == 0) {
+        return false;
+    }
+    if (v < 0 || v >= m_nvar || !m_var[v].IsCategorical || LossWeight < 0) {
+        return false;
+    }
+
+    std::vector<CRecodeSearchTable> Tables;
+    std::vector<double> Freq;
+    if (!PrepareRecodeSearch(v, Tables, Freq)) {
+        return false;
+    }
+    int n = Freq.size();
+    double Entropy = GroupEntropy(Freq);
+    CVariable *var = &(m_var[v]);
+
+    double BestCost = 0;
+    for (t = 0; t < var->nPos; t++) {
+        // codes with the same first nPos - t positions form a group, they are adjacent
+        std::vector<int> First;
+        int width = var->nPos - t;
+        for (c = 0; c < n; c++) {
+            if (c == 0 || var->sCode[c].compare(0, width, var->sCode[c - 1], 0, width) != 0) {
+                First.push_back(c);
+            }
+        }
+        CRecodeSearchState s;
+        MakeRecodeSearchState(Tables, Freq, First, s);
+        SetRecodeSearchCost(s, Entropy, LossWeight);
+        if (t == 0 || s.Cost < BestCost) {
+            BestCost = s.Cost;
+            *nPos = t;
+            *nUnsafe = s.nUnsafe;
+            *EntropyLoss = s.Loss;
+        }
+        if (s.nUnsafe == 0) break;  // truncating more only loses information
+    }
+    return true;
+}
+
 /**
  * Reduces the number of codes of a variable by grouping several codes together. 
  * The RecodeString are separated by newline characters(\r \n).
@@ -1783,19 +2678,8 @@ bool CMuArgCtrl::UnsafeVariableClose(long VarIndex)
  */
 bool CMuArgCtrl::DoRecode(long VarIndex, const char *RecodeString, const char *eMissing1, const char *eMissing2, long *ErrorType, long *ErrorLine, long *ErrorPos, const char **WarningString)
 {
-    int i, v = VarIndex - 1, oke, maxwidth = 0;
+    int v = VarIndex - 1;
     *ErrorType = *ErrorLine = *ErrorPos = -1;
-    
-    //std::string temp, Missing1, Missing2, sRecodeString;
-    std::string Missing1, Missing2;
-
-    Missing1 = eMissing1;
-    Missing2 = eMissing2;
-    
-    // for warnings
-    m_nOverlap = 0;
-    m_nUntouched = 0;
-    m_nNoSense = 0;
 
     m_WarningRecode.resize(0);
 
@@ -1811,16 +2695,96 @@ bool CMuArgCtrl::DoRecode(long VarIndex, const char *RecodeString, const char *e
 	return false;
     }
 
+    SetRecodeChanged(v);
     if (m_var[v].HasRecode) {
     	m_var[v].UndoRecode();
     }
+    m_var[v].HierarchyLevel = 0;  // not a level of the hierarchy, see FindLevelTable
+
+    // applied before? then take it from the recent versions
+    std::string Spec = NormalizeRecodeSpec(RecodeString, eMissing1, eMissing2);
+    int k = m_var[v].FindRecodeVersion(Spec);
+    if (k >= 0) {
+        if (!m_var[v].UseRecodeVersion(k, m_WarningRecode)) {
+            *ErrorType = NOTENOUGHMEMORY;
+            return false;
+        }
+    }
+    else {
+        if (!MakeRecode(v, RecodeString, eMissing1, eMissing2, ErrorType, ErrorLine, ErrorPos)) {
+            return false;
+        }
+        m_var[v].AddRecodeVersion(Spec, m_WarningRecode);
+    }
+
+    *WarningString = m_WarningRecode.c_str();
+    //*WarningString = m_WarningRecode.AllocSysString();
+
+    m_var[v].HasRecode = true;
+    m_UCProfileValid = false;
+    m_BIRCellsValid = false;
+
+    return true;
+}
+
+// key of a recode in the recent versions of a variable: the missings and of every line
+// of the recode string the part that is parsed, lines that are skipped left out (see ParseRecodeStringLine)
+std::string CMuArgCtrl::NormalizeRecodeSpec(const char *RecodeString, const char *eMissing1, const char *eMissing2)
+{
+    std::string Spec = "R";
+    const char *line = RecodeString, *p;
+
+    Spec += eMissing1;
+    Spec += '\0';
+    Spec += eMissing2;
+    while (1) {
+        int i = 0;
+        while (line[i] == ' ') i++;
+        if (line[i] != 0 && !(line[i] < 32)) {  // not a useless line
+            Spec += '\0';
+            Spec.append(line, strcspn(line, "\r\n"));
+        }
+        p = strstr(line, SEPARATOR);
+        if (p == 0) break;
+        line = p + strlen(SEPARATOR);
+    }
+    return Spec;
+}
+
+// computes the recode of variable v in m_var[v].Recode (DestCode, sCode, nCode, missings)
+// and the warnings in m_WarningRecode. HasRecode is left to the caller
+bool CMuArgCtrl::MakeRecode(int v, const char *RecodeString, const char *eMissing1, const char *eMissing2, long *ErrorType, long *ErrorLine, long *ErrorPos)
+{
+    int i, oke, maxwidth = 0;
+
+    //std::string temp, Missing1, Missing2, sRecodeString;
+    std::string Missing1, Missing2;
+
+    Missing1 = eMissing1;
+    Missing2 = eMissing2;
+    
+    // for warnings
+    m_nOverlap = 0;
+    m_nUntouched = 0;
+    m_nNoSense = 0;
+
+    m_WarningRecode.resize(0);
 
-    // only check syntax, phase = CHECK
-    oke = ParseRecodeString(v, RecodeString, ErrorType, ErrorLine, ErrorPos, CHECK);
+    // parse the recode string once in a list of rules, syntax checked
+    std::vector<RECODERULE> Rules;
+    oke = ParseRecodeString(v, RecodeString, Rules, ErrorType, ErrorLine, ErrorPos);
     if (!oke) {
 	return false;
     }
 
+    // compute the range of source codes of every rule, binary search in the sorted codes
+    for (i = 0; i < (int) Rules.size(); i++) {
+        ResolveRecodeRule(v, Rules[i]);
+        if (Rules[i].Status == R_CODENOTINLIST || Rules[i].Status == R_NOSENSE) {
+            m_nNoSense++;
+        }
+    }
+
     if (!m_var[v].PrepareRecode()) {
 	*ErrorType = NOTENOUGHMEMORY;
 	return false;
@@ -1839,7 +2803,13 @@ bool CMuArgCtrl::DoRecode(long VarIndex, const char *RecodeString, const char *e
             Missing2 = Missing1;
 	}
     }
-    ParseRecodeString(v, RecodeString, ErrorType, ErrorLine, ErrorPos, DESTCODE);
+    // destination codes, every code once
+    std::set<std::string> RecodeCodes;
+    for (i = 0; i < (int) Rules.size(); i++) {
+        if (RecodeCodes.insert(Rules[i].DestCode).second) {
+            m_var[v].Recode.sCode.push_back(Rules[i].DestCode);
+        }
+    }
     if (m_var[v].Recode.sCode.size() < 1) {
 	*ErrorType = E_EMPTYSPEC;
 	*ErrorLine = 1;
@@ -1850,22 +2820,45 @@ bool CMuArgCtrl::DoRecode(long VarIndex, const char *RecodeString, const char *e
     // sort list of dest codes, still without missing values (coming soon)
     m_var[v].SortRecodedCode( 0, m_var[v].Recode.sCode.size() - 1);
 
-    // now the number of codes is known, but not the not mentioned ones
-    // m_var[v].Recode.nCode = m_var[v].Recode.sCode.GetSize();
-    // again, now compute dest codes and link between dest and src
-    oke = ParseRecodeString(v, RecodeString, ErrorType, ErrorLine, ErrorPos, SRCCODE);
-    if (!oke) {
-	return false;  // missing to valid codes, a terrible shame
+    // never make from a missing value a valid value!
+    for (i = 0; i < (int) Rules.size(); i++) {
+        if (Rules[i].Status == R_MISSING2VALID) {   // a mortal sin
+            *ErrorType = R_MISSING2VALID;
+            *ErrorLine = Rules[i].Line;
+            *ErrorPos = Rules[i].Pos;
+            return false;
+        }
     }
 
+    // sweep over the source ranges sorted on first code:
+    // codes in no range are untouched, codes in more than one range overlap
+    int nValid = m_var[v].nCode - m_var[v].nMissing, next = 0;
+    long nSrc = 0;
+    std::vector< std::pair<int, int> > Ranges;
+    for (i = 0; i < (int) Rules.size(); i++) {
+        if (Rules[i].Status == 0) {
+            Ranges.push_back(std::make_pair(Rules[i].First, Rules[i].Last));
+        }
+    }
+    std::sort(Ranges.begin(), Ranges.end());
+
     // compute untouched codes, add them to the recode codelist
     m_nUntouched = 0;
-    for (i = 0; i < m_var[v].nCode - m_var[v].nMissing; i++) {
-	if (m_var[v].Recode.DestCode[i] == -1) { // not touched
+    for (int r = 0; r <= (int) Ranges.size(); r++) {
+        int first = (r < (int) Ranges.size()) ? Ranges[r].first : nValid;
+        for (i = next; i < first; i++) {  // not touched
             m_nUntouched++;
-            m_var[v].AddRecode(m_var[v].sCode[i].c_str());
-	}
+            if (RecodeCodes.insert(m_var[v].sCode[i]).second) {
+                m_var[v].Recode.sCode.push_back(m_var[v].sCode[i]);
+            }
+        }
+        if (r < (int) Ranges.size()) {
+            nSrc += Ranges[r].second - Ranges[r].first + 1;
+            next = std::max(next, Ranges[r].second + 1);
+        }
     }
+    m_nOverlap = nSrc - (nValid - m_nUntouched);
+
     // make all recode codes same width
     maxwidth = m_var[v].MakeRecodelistEqualWidth(Missing1, Missing2);
 
@@ -1931,16 +2924,27 @@ bool CMuArgCtrl::DoRecode(long VarIndex, const char *RecodeString, const char *e
 	m_var[v].AddRecode(m_var[v].Recode.Missing2.c_str());
     }
 
-    // last time, now compute dest codes and link between dest and src
-    // for warnings
-    m_nOverlap = 0;
-    m_nNoSense = 0;
+    // now compute dest codes and link between dest and src
     for (i = 0; i < m_var[v].nCode; i++) {
         m_var[v].Recode.DestCode[i] = -1;
     }
-    oke = ParseRecodeString(v, RecodeString, ErrorType, ErrorLine, ErrorPos, SRCCODE);
-    if (!oke) {
-    	return false;  // missing to valid codes, a terrible shame
+    // the last rule for a code counts: do the rules backwards, every code is set once,
+    // Unfilled jumps over codes already set
+    std::vector<int> Unfilled(nValid + 1);
+    for (i = 0; i <= nValid; i++) {
+        Unfilled[i] = i;
+    }
+    for (int r = Rules.size() - 1; r >= 0; r--) {
+        if (Rules[r].Status != 0) continue;
+        bool DestMissing;
+        std::string dest = Rules[r].DestCode;
+        AddSpacesBefore(dest, m_var[v].Recode.CodeWidth);
+        int DestIndex = m_var[v].FindRecodedCode(dest, m_var[v].Recode.nMissing, DestMissing);
+        assert(DestIndex >= 0 && DestIndex < (int) m_var[v].Recode.sCode.size());
+        for (int c = NextUnfilled(Unfilled, Rules[r].First); c <= Rules[r].Last; c = NextUnfilled(Unfilled, c + 1)) {
+            m_var[v].Recode.DestCode[c] = DestIndex;
+            Unfilled[c] = c + 1;
+        }
     }
 
     // yep, the number of codes is known and the codes are sorted (except one or two MISSINGs at the end of te list)
@@ -2005,11 +3009,6 @@ bool CMuArgCtrl::DoRecode(long VarIndex, const char *RecodeString, const char *e
         m_WarningRecode = "Recode OK";
     }
 
-    *WarningString = m_WarningRecode.c_str();
-    //*WarningString = m_WarningRecode.AllocSysString();
-
-    m_var[v].HasRecode = true;
-
     return true;
 }
 
@@ -2019,11 +3018,9 @@ bool CMuArgCtrl::DoRecode(long VarIndex, const char *RecodeString, const char *e
 ///  1 : 90 - 500
 ///  2 : 500 -
 ///  3 : 11,13, 512, 530-570, 930-970
-///  phase: CHECK       check only syntax
-///         DESTCODE    compute and sort dest code
-///         SRCCODE     compute link between src and dest code
+///  every source code (range) gives a rule in Rules, syntax is checked
 
-bool CMuArgCtrl::ParseRecodeString(long VarIndex, const char *RecodeString, long *ErrorType, long *ErrorLine, long *ErrorPos, int Phase)
+bool CMuArgCtrl::ParseRecodeString(long VarIndex, const char *RecodeString, std::vector<RECODERULE> &Rules, long *ErrorType, long *ErrorLine, long *ErrorPos)
 { 
     const char *p;
     int PosInString = 0, LineNumber = 1;
@@ -2031,7 +3028,7 @@ bool CMuArgCtrl::ParseRecodeString(long VarIndex, const char *RecodeString, long
 
     // first detect lines in RecodeString
     while (1) {
-        oke = ParseRecodeStringLine(VarIndex, &RecodeString[PosInString], ErrorType,  ErrorPos, Phase);
+        oke = ParseRecodeStringLine(VarIndex, &RecodeString[PosInString], Rules, LineNumber, ErrorType,  ErrorPos);
         if (!oke) {
             *ErrorLine = LineNumber;
             return false;
@@ -2046,7 +3043,7 @@ bool CMuArgCtrl::ParseRecodeString(long VarIndex, const char *RecodeString, long
 }
 
 // Parse a line of a recode string (until str[i] == 0 || str[i] == '\n' || str[i] == '\r')
-bool CMuArgCtrl::ParseRecodeStringLine(long VarIndex, const char *str, long *ErrorType, long *ErrorPos, int Phase)
+bool CMuArgCtrl::ParseRecodeStringLine(long VarIndex, const char *str, std::vector<RECODERULE> &Rules, int LineNumber, long *ErrorType, long *ErrorPos)
 { 
     int i = 0, len = strlen(str), res, fromto, position;
     int nPos = m_var[VarIndex].nPos;
@@ -2115,21 +3112,16 @@ bool CMuArgCtrl::ParseRecodeStringLine(long VarIndex, const char *str, long *Err
             }
         }
 
-        switch (Phase) {
-            case DESTCODE:
-                m_var[VarIndex].AddRecode(DestCode);
-                break;
-            case SRCCODE:
-                {
-                    int ErrCode = SetCode2Recode(VarIndex, DestCode, SrcCode1, SrcCode2, fromto);
-                    if (ErrCode == R_MISSING2VALID) {   // a mortal sin
-                        *ErrorType = ErrCode;
-                        *ErrorPos = position + i + 1;
-                        return false;
-                    }
-                }
-                break;
-        }
+        RECODERULE rule;
+        rule.DestCode = DestCode;
+        rule.SrcCode1 = SrcCode1;
+        rule.SrcCode2 = SrcCode2;
+        rule.fromto = fromto;
+        rule.Line = LineNumber;
+        rule.Pos = position + i + 1;
+        rule.First = rule.Last = -1;
+        rule.Status = 0;
+        Rules.push_back(rule);
 
         i += res;
 
@@ -2138,31 +3130,33 @@ bool CMuArgCtrl::ParseRecodeStringLine(long VarIndex, const char *str, long *Err
     return true;
 }
 
-
-int CMuArgCtrl::SetCode2Recode(int VarIndex, char *DestCode, char *SrcCode1, char *SrcCode2, int fromto)
+// index of code in the codes of v, missings included.
+// Not found: index of the first bigger non-missing code, number of non-missing codes if none
+int CMuArgCtrl::FindRecodeSource(int VarIndex, const std::string &code, bool &Exact, bool &IsMissing)
 {
     CVariable *v = &(m_var[VarIndex]);
-    int c, c1 = 0, c2 = 0;
     int n_codes = v->sCode.size() - v->nMissing;
-    int DestIndex, Exact;
-    bool DestMissing, Src1Missing, Src2Missing;
-    // compute index SrcCode1
-    Exact = true;
-    //if (c1 = BinSearchStringArray(v->sCode, SrcCode1, v->nMissing, Src1Missing), c1 < 0) { // not found?
-    c1 = v->FindCode(SrcCode1, v->nMissing, Src1Missing);
-    if (c1 <0) {
-	Exact = false;
-	if (v->sCode[n_codes - 1] < SrcCode1) {  // bigger then last code
-            c1 = n_codes;
-	}
-	else {
-            c1 = 0;
-            while (m_var[VarIndex].sCode[c1] < SrcCode1) c1++;
-	}
+
+    int c = v->FindCode(code, v->nMissing, IsMissing);
+    Exact = (c >= 0);
+    if (!Exact) {
+        c = std::lower_bound(v->sCode.begin(), v->sCode.begin() + n_codes, code) - v->sCode.begin();
     }
+    return c;
+}
+
+// computes the range First - Last of source codes of a rule, Status != 0 if the rule is not used
+void CMuArgCtrl::ResolveRecodeRule(int VarIndex, RECODERULE &rule)
+{
+    CVariable *v = &(m_var[VarIndex]);
+    int c1, c2 = 0;
+    int n_codes = v->sCode.size() - v->nMissing;
+    bool Exact, Src1Missing, Src2Missing;
+
+    c1 = FindRecodeSource(VarIndex, rule.SrcCode1, Exact, Src1Missing);
 
     Src2Missing = false;
-    switch (fromto) {
+    switch (rule.fromto) {
 	case FROMTO_TO:
             c2 = c1;
             if (!Exact) c2--;
@@ -2170,8 +3164,8 @@ int CMuArgCtrl::SetCode2Recode(int VarIndex, char *DestCode, char *SrcCode1, cha
             break;
 	case FROMTO_SOLO:
             if (!Exact) {
-		m_nNoSense++;
-                return R_CODENOTINLIST;
+                rule.Status = R_CODENOTINLIST;
+                return;
             }
             c2 = c1;
             break;
@@ -2179,59 +3173,46 @@ int CMuArgCtrl::SetCode2Recode(int VarIndex, char *DestCode, char *SrcCode1, cha
             c2 = n_codes - 1;
             break;
 	case FROMTO_RANGE:
-            if (fromto == FROMTO_RANGE) {   // compute index SrcCode2
-                Exact = true;
-		if (c2 = v->FindCode(SrcCode2, v->nMissing, Src2Missing), c2 < 0) { // not found?
-                    Exact = false;
-                    if (v->sCode[n_codes - 1] < SrcCode2) {  // bigger then last code, oke
-                        c2 = n_codes;
-                    }
-                    else {
-                        c2 = 0;
-                        while (m_var[VarIndex].sCode[c2] < SrcCode2) c2++;
-                    }
-		}
-		if (!Exact) c2--;
-            }
+            c2 = FindRecodeSource(VarIndex, rule.SrcCode2, Exact, Src2Missing);
+            if (!Exact) c2--;
             break;
 	default:
             assert(1 == 2);
-            return PROGRAMERROR;
+            rule.Status = PROGRAMERROR;
+            return;
     }
 
     if (c2 < c1) {
-        m_nNoSense++;
-	return R_NOSENSE;
+        rule.Status = R_NOSENSE;
+        return;
     }
     // c1 and c2 now are correct, I assume
-    assert(c1 >= 0 && c1 < v->sCode.size() && c2 >= c1 && c2 < v->sCode.size());
-
-    // search destcode in list
-    assert(v->nMissing > 0 && v->nMissing < 3);
-
-    AddSpacesBefore(DestCode, v->Recode.CodeWidth);
-    DestIndex = v->FindRecodedCode(DestCode, v->Recode.nMissing, DestMissing);
+    assert(c1 >= 0 && c1 < (int) v->sCode.size() && c2 >= c1 && c2 < (int) v->sCode.size());
 
     // never make from a missing value a valid value!
-    if (!DestMissing && (Src1Missing || Src2Missing) ) {
-        return R_MISSING2VALID;
+    // The missings of the recode are not known yet, so a missing source is always refused
+    if (Src1Missing || Src2Missing) {
+        rule.Status = R_MISSING2VALID;
+        return;
     }
+    rule.First = c1;
+    rule.Last = c2;
+}
 
-    assert(DestIndex >= 0 && DestIndex < v->Recode.sCode.size() );
-    if (DestIndex < 0 || DestIndex >= v->Recode.sCode.size() ) {
-        return PROGRAMERROR;
-    }
+// first code >= c that is not filled yet, see MakeRecode
+int CMuArgCtrl::NextUnfilled(std::vector<int> &Unfilled, int c)
+{
+    int root = c;
 
-    // put dest code
-    for (c = c1; c <= c2; c++) {
-        int d = v->Recode.DestCode[c];
-	if (d != -1) {
-            m_nOverlap++;
-	}
-	v->Recode.DestCode[c] = DestIndex;
+    while (Unfilled[root] != root) {
+        root = Unfilled[root];
     }
-
-    return 0;
+    while (Unfilled[c] != root) {  // shorten the path for the next time
+        int next = Unfilled[c];
+        Unfilled[c] = root;
+        c = next;
+    }
+    return root;
 }
 
 int CMuArgCtrl::ReadWord(const char *str, char* CodeFrom, char *CodeTo, char EndCode, int& fromto, int& pos)
@@ -2376,6 +3357,10 @@ bool CMuArgCtrl::UndoRecode(long VarIndex)
 
     // set variable without recode, only change the flag
     m_var[v].HasRecode = false;
+    m_var[v].HierarchyLevel = 0;
+    m_UCProfileValid = false;
+    m_BIRCellsValid = false;
+    SetRecodeChanged(v);
 
     // recomputes for all tables the flag HasRecode
     SetTableHasRecode();
@@ -2406,8 +3391,7 @@ void CMuArgCtrl::SetTableHasRecode()
  */
 bool CMuArgCtrl::DoTruncate(long VarIndex, long nPos)
 {
-    int i, v = VarIndex - 1;
-    int VarWidth, nCode, NewWidth;
+    int v = VarIndex - 1;
     // too early?
     if (m_nvar == 0 || m_ntab == 0 || m_fname[0] == 0) {
 	return false;
@@ -2417,19 +3401,53 @@ bool CMuArgCtrl::DoTruncate(long VarIndex, long nPos)
     if (v < 0 || v >= m_nvar || !m_var[v].IsCategorical) {
 	return false;
     }
+    SetRecodeChanged(v);
     if (m_var[v].Recode.DestCode != 0) {
         m_var[v].UndoRecode();
     }
-    // initialize new recode
-    if (!m_var[v].PrepareRecode()) {
+    m_var[v].HierarchyLevel = 0;  // not a level of the hierarchy, see FindLevelTable
+
+    // truncated like this before? then take it from the recent versions
+    std::ostringstream Spec;
+    Spec << "T" << nPos;
+    int k = m_var[v].FindRecodeVersion(Spec.str());
+    if (k >= 0) {
+        std::string Warning;
+        if (!m_var[v].UseRecodeVersion(k, Warning)) {
+            return false;
+        }
+        m_var[v].HasRecode = true;
+        m_UCProfileValid = false;
+        m_BIRCellsValid = false;
+        return true;
+    }
+
+    if (!MakeTruncate(v, nPos)) {
         return false;
     }
+    m_var[v].HasRecode = true;
+    m_UCProfileValid = false;
+    m_BIRCellsValid = false;
+    m_var[v].AddRecodeVersion(Spec.str(), "");
+
+    return true;
+}
+
+// computes the truncation of variable v by nPos positions in m_var[v].Recode
+bool CMuArgCtrl::MakeTruncate(int v, int nPos)
+{
+    int i, VarWidth, nCode, NewWidth;
 
     VarWidth = m_var[v].nPos;
     if (nPos >= VarWidth) {
 	return false;
     }
 
+    // initialize new recode
+    if (!m_var[v].PrepareRecode()) {
+        return false;
+    }
+
     NewWidth = VarWidth - nPos;
     m_var[v].Recode.sCode.clear();
 
@@ -2449,7 +3467,6 @@ bool CMuArgCtrl::DoTruncate(long VarIndex, long nPos)
     m_var[v].Recode.Missing1 = m_var[v].Missing1;
     m_var[v].Recode.Missing2 = m_var[v].Missing2;
     m_var[v].Recode.nMissing = m_var[v].nMissing;
-    m_var[v].HasRecode = true;
 
     //m_var[v].Recode.sCode.Add(m_var[v].Recode.Missing1);
     m_var[v].Recode.sCode.push_back(m_var[v].Recode.Missing1);
@@ -2464,6 +3481,175 @@ bool CMuArgCtrl::DoTruncate(long VarIndex, long nPos)
     return true;
 }
 
+/**
+ * Defines the code hierarchy of a variable by prefixes of its codes, e.g. for NACE, ISCO or region codes.
+ * Level l groups the codes with the same first PrefixLength[l - 1] positions, as DoTruncate does
+ * with nPos - PrefixLength[l - 1] positions. A hierarchy defined before is replaced.
+ * The roll-up of the codes and the base tables with the codes of every level are computed
+ * once (again by ComputeTables), so DoHierarchyLevel can switch to a level without recomputing
+ * the tables from the data.
+ * @param VarIndex      Index of variable
+ * @param nLevels       Number of levels
+ * @param PrefixLength  For every level the number of positions kept, decreasing
+ * @return false if one or more parameters is wrong or the codes are not known yet (ExploreFile)
+ */
+bool CMuArgCtrl::SetHierarchyPrefix(long VarIndex, long nLevels, long *PrefixLength)
+{
+    int v = VarIndex - 1, l;
+
+    // too early?
+    if (m_nvar == 0 || m_fname[0] == 0) {
+	return false;
+    }
+    if (v < 0 || v >= m_nvar || !m_var[v].IsCategorical || nLevels < 1) {
+	return false;
+    }
+    for (l = 0; l < nLevels; l++) {
+        if (PrefixLength[l] < 1 || PrefixLength[l] >= (l == 0 ? m_var[v].nPos : PrefixLength[l - 1])) {
+            return false;
+        }
+    }
+
+    // the levels are made in Recode, keep the current one aside
+    RECODE SavedRecode = m_var[v].Recode;
+    bool ok = true;
+    m_var[v].ClearHierarchy();
+    for (l = 0; l < nLevels && ok; l++) {
+        m_var[v].Recode.DestCode = 0;
+        ok = MakeTruncate(v, m_var[v].nPos - PrefixLength[l]) && m_var[v].AddHierarchyRecode();
+        if (m_var[v].Recode.DestCode != 0) {
+            free(m_var[v].Recode.DestCode);
+        }
+    }
+    m_var[v].Recode = SavedRecode;
+    if (!ok) {
+        m_var[v].ClearHierarchy();
+    }
+    ComputeLevelTables(v);
+    return ok;
+}
+
+/**
+ * Adds a level to the code hierarchy of a variable. The level is given by a recode
+ * specification of the original codes (see DoRecode) that has to group the codes of the
+ * previous level. The roll-up of the codes and the base tables with the codes of the level
+ * are computed once, see DoHierarchyLevel.
+ * @param VarIndex      Index of variable
+ * @param RecodeString  Recode specification of the codes of the level
+ * @param ErrorType     Error as in DoRecode, E_NOTNESTED if the codes of the previous level are not grouped
+ * @param ErrorLine     Line where error occurred
+ * @param ErrorPos      Position where error occurred in line
+ * @return false if one or more parameters is wrong or the specification is not correct
+ */
+bool CMuArgCtrl::AddHierarchyLevel(long VarIndex, const char *RecodeString, long *ErrorType, long *ErrorLine, long *ErrorPos)
+{
+    int v = VarIndex - 1;
+    *ErrorType = *ErrorLine = *ErrorPos = -1;
+
+    // too early?
+    if (m_nvar == 0 || m_fname[0] == 0) {
+    	*ErrorType =  E_NOVARTABDATA;
+	return false;
+    }
+    if (v < 0 || v >= m_nvar || !m_var[v].IsCategorical) {
+	*ErrorType =  E_VARINDEXWRONG;
+	return false;
+    }
+
+    // the level is made in Recode, keep the current one aside
+    RECODE SavedRecode = m_var[v].Recode;
+    std::string SavedWarning = m_WarningRecode;
+    m_var[v].Recode.DestCode = 0;
+    bool ok = MakeRecode(v, RecodeString, "", "", ErrorType, ErrorLine, ErrorPos);
+    if (ok && !m_var[v].GroupsHierarchyLevel()) {
+        *ErrorType = E_NOTNESTED;
+        ok = false;
+    }
+    if (ok && !m_var[v].AddHierarchyRecode()) {
+        *ErrorType = NOTENOUGHMEMORY;
+        ok = false;
+    }
+    if (m_var[v].Recode.DestCode != 0) {
+        free(m_var[v].Recode.DestCode);
+    }
+    m_var[v].Recode = SavedRecode;
+    m_WarningRecode = SavedWarning;
+    if (ok) {
+        ComputeLevelTables(v);
+    }
+    return ok;
+}
+
+/**
+ * Removes the code hierarchy of a variable. A current recode to one of the levels stays.
+ * @param VarIndex      Index of variable
+ * @return false if VarIndex is wrong
+ */
+bool CMuArgCtrl::ClearHierarchy(long VarIndex)
+{
+    int v = VarIndex - 1;
+
+    if (v < 0 || v >= m_nvar || !m_var[v].IsCategorical) {
+	return false;
+    }
+    m_var[v].ClearHierarchy();
+    FreeLevelTables(v);
+    return true;
+}
+
+/**
+ * Recodes a variable to a level of its code hierarchy, see SetHierarchyPrefix and AddHierarchyLevel.
+ * Level 0 gives the original codes (as UndoRecode). ApplyRecode takes the tables with the codes
+ * of the level, that are computed already, instead of recoding the base tables.
+ * @param VarIndex      Index of variable
+ * @param Level         Level of the hierarchy, 0 for the original codes
+ * @return false if one or more parameters is wrong
+ */
+bool CMuArgCtrl::DoHierarchyLevel(long VarIndex, long Level)
+{
+    int v = VarIndex - 1;
+
+    // too early?
+    if (m_nvar == 0 || m_ntab == 0 || m_fname[0] == 0) {
+	return false;
+    }
+    if (v < 0 || v >= m_nvar || !m_var[v].IsCategorical) {
+	return false;
+    }
+    if (Level < 0 || Level > (long) m_var[v].Hierarchy.size()) {
+	return false;
+    }
+    if (Level == 0) {
+        return UndoRecode(VarIndex);
+    }
+
+    SetRecodeChanged(v);
+    if (m_var[v].Recode.DestCode != 0) {
+        m_var[v].UndoRecode();
+    }
+
+    std::ostringstream Spec;
+    Spec << "H" << Level;
+    int k = m_var[v].FindRecodeVersion(Spec.str());
+    if (k >= 0) {
+        std::string Warning;
+        if (!m_var[v].UseRecodeVersion(k, Warning)) {
+            return false;
+        }
+    }
+    else {
+        if (!m_var[v].UseHierarchyLevel(Level)) {
+            return false;
+        }
+        m_var[v].AddRecodeVersion(Spec.str(), "");
+    }
+    m_var[v].HierarchyLevel = Level;
+    m_var[v].HasRecode = true;
+    m_UCProfileValid = false;
+    m_BIRCellsValid = false;
+    return true;
+}
+
 /**
  * Re-calculates the (sub)tables, e.g., because of a recoding
  * Results can be retrieved using 
@@ -2475,11 +3661,279 @@ bool CMuArgCtrl::DoTruncate(long VarIndex, long nPos)
  */
 bool CMuArgCtrl::ApplyRecode()
 {
+    // only the tables with a variable recoded since the last time have to be computed again
+    bool incremental = (m_UCList != 0 && m_RecodeTablesValid);
+
     ComputeRecodeTables();
-    ComputeSubTableList();
+    if (incremental) {
+        UpdateSubTableList();
+    }
+    else {
+        ComputeSubTableList();
+    }
+    m_VarRecodeChanged.assign(m_nvar, false);
+    return true;
+}
+
+// remember that the recode of variable v is changed, see ApplyRecode
+void CMuArgCtrl::SetRecodeChanged(int v)
+{
+    if ((long) m_VarRecodeChanged.size() != m_nvar) {
+        m_VarRecodeChanged.assign(m_nvar, false);
+    }
+    m_VarRecodeChanged[v] = true;
+}
+
+// true if one of the variables is changed by a recode since the last ApplyRecode
+bool CMuArgCtrl::IsRecodeChanged(int nDim, const int *Varnr)
+{
+    if ((long) m_VarRecodeChanged.size() != m_nvar) {
+        return false;
+    }
+    for (int d = 0; d < nDim; d++) {
+        if (m_VarRecodeChanged[Varnr[d]]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// after ApplyRecode: computes again only the entries of m_UCList with a changed variable.
+// The variable combinations and thresholds do not depend on recodes,
+// so the order of m_UCList, biggestThreshold and the index stay the same.
+// The source of a changed subtable always contains the changed variable too.
+int CMuArgCtrl::UpdateSubTableList()
+{
+    int i, dim, maxdim = 0, iTab;
+    std::vector<bool> changed(m_nUC, false);
+    std::vector<bool> wasBIR(m_nUC, false);  // choose the same kind of source as before
+    std::vector<bool> restored(m_nUC, false); // taken from the tables kept for the current versions
+    std::vector<int> next(m_ntab, 0);         // per base table the next entry in m_TabRestore
+    bool caching = ((long) m_TabStash.size() == m_ntab);
+
+    if (m_unsafe != 0) {
+        delete [] m_unsafe;
+	m_unsafe = 0;
+    }
+    m_unsafe = new int[1][MAXDIM + 1];
+    memset(m_unsafe, 0, sizeof(int) * (MAXDIM + 1));
+
+    m_nPrunedUC = 0;
+    m_UCProfileValid = false;
+    m_BIRCellsValid = false;
+
+    for (i = 0; i < m_nUC; i++) {
+        CUCList *u = &(m_UCList[i]);
+        iTab = (u->TabNr >= m_ntab) ? u->TabNr - m_ntab : u->TabNr;
+        bool base = (u->nDim == m_tab[u->TabNr].nDim);
+        changed[i] = IsRecodeChanged(u->nDim, u->Varnr);
+        if (changed[i] && caching && m_TabStash[iTab].Used) {  // keep the old (sub)table
+            CUCListState s;
+            wasBIR[i] = u->table.IsBIR;
+            s.Index = i;
+            s.nUC = u->nUC;
+            s.MinFreq = u->MinFreq;
+            s.Pruned = u->Pruned;
+            if (!base) {
+                s.table = u->table;
+                u->table.Cell = 0;
+                u->table.nCell = 0;
+                u->table.BIRCell = 0;
+            }
+            m_TabStash[iTab].UC.push_back(s);
+        }
+        else if (changed[i] && !base) {  // free the old subtable
+            wasBIR[i] = u->table.IsBIR;
+            delete[] u->table.Cell;
+            u->table.Cell = 0;
+            u->table.nCell = 0;
+            if (u->table.IsBIR && u->table.BIRCell != 0) {  // only then BIRCell is its own
+                delete[] u->table.BIRCell;
+                u->table.BIRCell = 0;
+            }
+        }
+        u->TabNr = m_tab[iTab].HasRecode ? iTab + m_ntab : iTab;
+        if (changed[i] && caching && m_TabRestore[iTab].Used) {  // computed before for these versions?
+            std::vector<CUCListState> &uc = m_TabRestore[iTab].UC;
+            while (next[iTab] < (int) uc.size() && uc[next[iTab]].Index < i) next[iTab]++;
+            if (next[iTab] < (int) uc.size() && uc[next[iTab]].Index == i) {
+                CUCListState *s = &(uc[next[iTab]]);
+                if (!base) {
+                    u->table = s->table;
+                    s->table.Cell = 0;
+                    s->table.BIRCell = 0;
+                }
+                u->nUC = s->nUC;
+                u->MinFreq = s->MinFreq;
+                u->Pruned = s->Pruned;
+                restored[i] = true;
+            }
+        }
+        if (changed[i] && base && !restored[i]) {
+            u->MinFreq = ComputeMinFreq(m_tab[u->TabNr]);
+        }
+        if (u->nDim > maxdim) {
+            maxdim = u->nDim;
+        }
+    }
+
+    CTable t;
+    int nTables = 0;
+    for (dim = maxdim - 1; dim > 0; dim--) {
+        for (i = 0; i < m_nUC; i++) {
+            CUCList *u = &(m_UCList[i]);
+            if (u->nDim != dim || !changed[i] || restored[i]) continue;
+            if (dim == m_tab[u->TabNr].nDim) continue;
+            ComputeUCListTable(i, maxdim, t, nTables, wasBIR[i] ? 1 : 0);
+        }
+    }
+    FireUpdateProgress(100);
+
+    for (i = 0; i < m_nUC; i++) {
+        if (changed[i] && !restored[i]) {
+            ComputeUCListUnsafe(i);
+        }
+        if (m_UCList[i].Pruned) {
+            m_nPrunedUC++;
+        }
+    }
+
+    // keep the tables of the previous versions, free what is not used of the current ones
+    for (iTab = 0; caching && iTab < m_ntab; iTab++) {
+        if (m_TabStash[iTab].Used) {
+            std::vector<CRecodedTables> &cache = m_RecodedTablesCache[iTab];
+            if (cache.size() >= RECODECACHESIZE) {
+                int k, oldest = 0;
+                for (k = 1; k < (int) cache.size(); k++) {
+                    if (cache[k].LastUsed < cache[oldest].LastUsed) {
+                        oldest = k;
+                    }
+                }
+                FreeRecodedTables(cache[oldest]);
+                cache.erase(cache.begin() + oldest);
+            }
+            m_TabStash[iTab].Used = false;
+            m_TabStash[iTab].LastUsed = ++m_RecodeCacheClock;
+            cache.push_back(m_TabStash[iTab]);
+            m_TabStash[iTab] = CRecodedTables();
+        }
+        if (m_TabRestore[iTab].Used) {
+            FreeRecodedTables(m_TabRestore[iTab]);
+            m_TabRestore[iTab] = CRecodedTables();
+        }
+    }
+    return maxdim;
+}
+
+// recode version of every dimension of base table iTab, 0 if the variable is not recoded
+void CMuArgCtrl::GetTableRecodeVersion(int iTab, int *Version)
+{
+    for (int d = 0; d < m_tab[iTab].nDim; d++) {
+        CVariable *var = &(m_var[m_tab[iTab].Varnr[d]]);
+        Version[d] = var->HasRecode ? var->RecodeVersion : 0;
+    }
+}
+
+// during ApplyRecode: puts the recoded table of base table iTab for the previous recode versions
+// in m_TabStash, UpdateSubTableList adds its changed (sub)tables. If the tables for the current
+// versions are kept, they are taken out of the cache in m_TabRestore.
+// Returns true if the recoded table is put back from there
+bool CMuArgCtrl::SwapRecodedTables(int iTab)
+{
+    int d, k, nDim = m_tab[iTab].nDim;
+    int *OldVersion = &m_TabVersion[iTab * MAXDIM];
+    int Version[MAXDIM];
+    bool OldRecoded = false, Recoded = false;
+
+    CRecodedTables *stash = &(m_TabStash[iTab]);
+    *stash = CRecodedTables();
+    stash->Used = true;
+    for (d = 0; d < nDim; d++) {
+        stash->Version[d] = OldVersion[d];
+        if (OldVersion[d] != 0) {
+            OldRecoded = true;
+        }
+    }
+    if (OldRecoded) {  // the cells go to the cache
+        stash->table = m_tab[iTab + m_ntab];
+        m_tab[iTab + m_ntab].Cell = 0;
+        m_tab[iTab + m_ntab].nCell = 0;
+        m_tab[iTab + m_ntab].BIRCell = 0;
+    }
+    else {  // left over of an older recode
+        m_tab[iTab + m_ntab].FreeRecodedTable();
+    }
+
+    GetTableRecodeVersion(iTab, Version);
+    for (d = 0; d < nDim; d++) {
+        OldVersion[d] = Version[d];
+        if (Version[d] != 0) {
+            Recoded = true;
+        }
+    }
+
+    m_TabRestore[iTab] = CRecodedTables();
+    std::vector<CRecodedTables> &cache = m_RecodedTablesCache[iTab];
+    for (k = 0; k < (int) cache.size(); k++) {
+        for (d = 0; d < nDim; d++) {
+            if (cache[k].Version[d] != Version[d]) break;
+        }
+        if (d == nDim) break;
+    }
+    if (k == (int) cache.size()) {
+        return false;
+    }
+    m_TabRestore[iTab] = cache[k];
+    m_TabRestore[iTab].Used = true;
+    cache.erase(cache.begin() + k);
+    if (!Recoded) {
+        return false;  // the base table is used, only (sub)tables are kept
+    }
+    m_tab[iTab + m_ntab] = m_TabRestore[iTab].table;
+    m_TabRestore[iTab].table.Cell = 0;
+    m_TabRestore[iTab].table.nCell = 0;
+    m_TabRestore[iTab].table.BIRCell = 0;
     return true;
 }
 
+// frees the cells of kept tables
+void CMuArgCtrl::FreeRecodedTables(CRecodedTables &rt)
+{
+    rt.table.FreeRecodedTable();
+    for (int k = 0; k < (int) rt.UC.size(); k++) {
+        CTable *t = &(rt.UC[k].table);
+        delete[] t->Cell;
+        t->Cell = 0;
+        if (t->IsBIR && t->BIRCell != 0) {  // only then BIRCell is its own
+            delete[] t->BIRCell;
+        }
+        t->BIRCell = 0;
+    }
+    rt.UC.clear();
+}
+
+// frees all tables kept for recode versions
+void CMuArgCtrl::ClearRecodedTablesCache()
+{
+    int i, k;
+
+    for (i = 0; i < (int) m_RecodedTablesCache.size(); i++) {
+        for (k = 0; k < (int) m_RecodedTablesCache[i].size(); k++) {
+            FreeRecodedTables(m_RecodedTablesCache[i][k]);
+        }
+    }
+    for (i = 0; i < (int) m_TabStash.size(); i++) {
+        FreeRecodedTables(m_TabStash[i]);
+    }
+    for (i = 0; i < (int) m_TabRestore.size(); i++) {
+        FreeRecodedTables(m_TabRestore[i]);
+    }
+    m_RecodedTablesCache.clear();
+    m_TabStash.clear();
+    m_TabRestore.clear();
+    m_TabVersion.clear();
+}
+
 bool CMuArgCtrl::ComputeRecodeTables()
 {
     int i, d, nRecodes = 0;
@@ -2489,90 +3943,611 @@ bool CMuArgCtrl::ComputeRecodeTables()
         return false;
     }
 
-    // compute number of variables with a recode
-    for (i = 0; i < m_nvar; i++) {
-	if (m_var[i].HasRecode) nRecodes++;
-    }
+    // compute number of variables with a recode
+    for (i = 0; i < m_nvar; i++) {
+	if (m_var[i].HasRecode) nRecodes++;
+    }
+
+    // keep the tables of the previous recode versions, see UpdateSubTableList
+    bool caching = m_RecodeTablesValid && m_UCList != 0 && (long) m_TabVersion.size() == m_ntab * MAXDIM;
+
+    if (nRecodes == 0 && !caching) { // nothing to do, why do you call me?
+	return false;
+    }
+
+    for (i = 0; i < m_ntab; i++) {
+	int nDim = m_tab[i].nDim;
+	bool changed = IsRecodeChanged(nDim, m_tab[i].Varnr);
+	bool restored = false;
+	if (caching && changed) {
+            restored = SwapRecodedTables(i);
+	}
+	for (d = 0; d < nDim; d++) {
+            // a base table with at least one recode?
+            if (m_var[m_tab[i].Varnr[d]].HasRecode) {
+                break;
+            }
+	}
+	if (d == nDim) { // table has no recodes
+            m_tab[i].HasRecode = false;
+            continue;
+	}
+	if (restored || (m_RecodeTablesValid && m_tab[i].HasRecode && !changed)) {
+            m_tab[i].HasRecode = true;
+            continue; // recoded table from the cache or still up to date
+	}
+	m_tab[i + m_ntab].FreeRecodedTable();
+
+	CTable dsttab = m_tab[i];
+	dsttab.Cell = 0;
+	dsttab.nCell =0;
+	dsttab.BIRCell =0;
+	for (d = 0; d < nDim; d++) {
+            if (m_var[m_tab[i].Varnr[d]].HasRecode) {
+                dsttab.SizeDim[d] = m_var[m_tab[i].Varnr[d] ].Recode.nCode;
+            }
+	}
+
+	// compute and save recoded table, from a level of a hierarchy if possible
+	int k = FindLevelTable(i);
+	if (k < 0) {
+            ComputeRecodeTable(m_tab[i], dsttab);
+	}
+	else {
+            int *remap[MAXDIM];
+            for (d = 0; d < nDim; d++) {
+                CVariable *var = &(m_var[m_tab[i].Varnr[d]]);
+                remap[d] = (d != m_LevelTab[k].Dim && var->HasRecode) ? var->Recode.DestCode : 0;
+            }
+            ComputeRecodeTable(m_LevelTab[k].table, dsttab, remap);
+	}
+	m_tab[m_ntab + i] = dsttab; // save for later use
+	m_tab[i].HasRecode = true;
+	m_tab[m_ntab + i].HasRecode = false;
+    }
+    m_RecodeTablesValid = true;
+
+    return true;
+}
+
+// computes the recoded table out of the source table with the recodes of the variables
+bool CMuArgCtrl::ComputeRecodeTable(CTable & srctab, CTable & dsttab)
+{
+    int *DestCode[MAXDIM];
+
+    for (int d = 0; d < srctab.nDim; d++) {
+        CVariable *var = &(m_var[srctab.Varnr[d]]);
+        DestCode[d] = var->HasRecode ? var->Recode.DestCode : 0;
+    }
+    return ComputeRecodeTable(srctab, dsttab, DestCode);
+}
+
+// computes the recoded table out of the source table, collapsing one recoded dimension at a time:
+// for every combination of the dimensions before it, the rows of the dimensions after it
+// are added to the row of the destination code. Tables of PARALLELMINCELLS cells or more are
+// done in parallel when built with OpenMP (-fopenmp, see nbproject)
+// DestCode[d]: for every code of dimension d the code in dsttab, 0 if d is not recoded
+bool CMuArgCtrl::ComputeRecodeTable(CTable & srctab, CTable & dsttab, int **DestCode)
+{
+    int d, last = -1, size[MAXDIM];
+    long p, n, before, after;
+
+    if (!dsttab.PrepareTable()) {
+        return false;
+    }
+
+    for (d = 0; d < srctab.nDim; d++) {
+        size[d] = srctab.SizeDim[d];
+        if (DestCode[d] != 0) {
+            last = d;
+        }
+    }
+    if (last < 0) {  // nothing to recode, just copy
+        memcpy(dsttab.Cell, srctab.Cell, sizeof(long) * dsttab.nCell);
+        if (dsttab.IsBIR) {
+            memcpy(dsttab.BIRCell, srctab.BIRCell, sizeof(double) * dsttab.nCell);
+        }
+        return true;
+    }
+
+    std::vector<long> cellbuf[2];
+    std::vector<double> birbuf[2];
+    const long *in = srctab.Cell;
+    const double *birin = srctab.BIRCell;
+    long *out;
+    double *birout = 0;
+    int buf = 0;
+
+    for (d = 0; d <= last; d++) {
+        if (DestCode[d] == 0) continue;
+
+        int nOld = size[d], nNew = dsttab.SizeDim[d];
+        const int *remap = DestCode[d];
+        before = 1;
+        for (int i = 0; i < d; i++) {
+            before *= size[i];
+        }
+        after = 1;
+        for (int i = d + 1; i < srctab.nDim; i++) {
+            after *= size[i];
+        }
+        n = before * nNew * after;
+
+        if (d == last) {  // directly in the recoded table
+            assert(n == dsttab.nCell);
+            out = dsttab.Cell;
+            if (dsttab.IsBIR) {
+                birout = dsttab.BIRCell;
+            }
+        }
+        else {
+            cellbuf[buf].assign(n, 0);
+            out = &cellbuf[buf][0];
+            if (dsttab.IsBIR) {
+                birbuf[buf].assign(n, 0);
+                birout = &birbuf[buf][0];
+            }
+        }
+
+#ifdef _OPENMP
+#pragma omp parallel for if (n >= PARALLELMINCELLS)
+#endif
+        for (p = 0; p < before; p++) {
+            for (int i = 0; i < nOld; i++) {
+                assert(remap[i] >= 0 && remap[i] < nNew);
+                long *dst = out + (p * nNew + remap[i]) * after;
+                const long *src = in + (p * nOld + i) * after;
+                for (long k = 0; k < after; k++) {
+                    dst[k] += src[k];
+                }
+                if (dsttab.IsBIR) {
+                    double *birdst = birout + (p * nNew + remap[i]) * after;
+                    const double *birsrc = birin + (p * nOld + i) * after;
+                    for (long k = 0; k < after; k++) {
+                        birdst[k] += birsrc[k];
+                    }
+                }
+            }
+        }
+
+        size[d] = nNew;
+        in = out;
+        birin = birout;
+        buf = 1 - buf;
+    }
+    return true;
+}
+
+
+// computes for every base table with variable v (every variable with a hierarchy if v < 0) the
+// table with the codes of every level of the hierarchy of the variable, see DoHierarchyLevel
+void CMuArgCtrl::ComputeLevelTables(int v)
+{
+    int i, d, l, w;
+    int *remap[MAXDIM];
+
+    FreeLevelTables(v);
+    for (i = 0; i < m_ntab; i++) {
+        if (m_tab[i].Cell == 0) continue;  // not computed yet, see ComputeTables
+        for (d = 0; d < m_tab[i].nDim; d++) {
+            w = m_tab[i].Varnr[d];
+            if (v >= 0 && w != v) continue;
+            for (l = 1; l <= (int) m_var[w].Hierarchy.size(); l++) {
+                RECODE *r = &(m_var[w].Hierarchy[l - 1]);
+                CLevelTable lt;
+                lt.TabNr = i;
+                lt.Dim = d;
+                lt.Level = l;
+                lt.table = m_tab[i];
+                lt.table.Cell = 0;
+                lt.table.nCell = 0;
+                lt.table.BIRCell = 0;
+                lt.table.SizeDim[d] = r->nCode;
+                for (int j = 0; j < m_tab[i].nDim; j++) {
+                    remap[j] = (j == d) ? r->DestCode : 0;
+                }
+                if (!ComputeRecodeTable(m_tab[i], lt.table, remap)) {
+                    lt.table.FreeRecodedTable();
+                    continue;
+                }
+                m_LevelTab.push_back(lt);
+            }
+        }
+    }
+}
+
+// frees the tables of ComputeLevelTables with variable v, all if v < 0
+void CMuArgCtrl::FreeLevelTables(int v)
+{
+    for (int k = m_LevelTab.size() - 1; k >= 0; k--) {
+        CLevelTable *lt = &(m_LevelTab[k]);
+        if (v < 0 || lt->table.Varnr[lt->Dim] == v) {
+            lt->table.FreeRecodedTable();
+            m_LevelTab.erase(m_LevelTab.begin() + k);
+        }
+    }
+}
+
+// index in m_LevelTab of the smallest table of base table iTab with a variable recoded
+// to a level of its hierarchy, -1 if none
+int CMuArgCtrl::FindLevelTable(int iTab)
+{
+    int k, best = -1;
+
+    for (k = 0; k < (int) m_LevelTab.size(); k++) {
+        CLevelTable *lt = &(m_LevelTab[k]);
+        if (lt->TabNr != iTab) continue;
+        CVariable *var = &(m_var[lt->table.Varnr[lt->Dim]]);
+        if (!var->HasRecode || var->HierarchyLevel != lt->Level) continue;
+        if (best < 0 || lt->table.nCell < m_LevelTab[best].table.nCell) {
+            best = k;
+        }
+    }
+    return best;
+}
+
+// computes for a candidate recode of variable v per dimension the number of unsafe combinations
+// in the tables with v, as UnsafeVariable would give after DoRecode and ApplyRecode.
+// The base tables are recoded in temporary tables, nothing of the session is changed
+void CMuArgCtrl::EvaluateRecodeCandidate(int v, int *DestCode, int nCode, int nMissing, long *UCArray)
+{
+    int i, j, k, d;
+    int *remap[MAXDIM];
+    int nValid[MAXDIM], subValid[MAXDIM];
+
+    for (i = 0; i < m_ntab; i++) {
+        CTable &base = m_tab[i];
+        for (d = 0; d < base.nDim; d++) {
+            if (base.Varnr[d] == v) break;
+        }
+        if (d == base.nDim) continue;  // v not in table
+
+        CTable rt = base;
+        rt.IsBIR = false;  // only frequencies needed
+        rt.Cell = 0;
+        rt.BIRCell = 0;
+        for (d = 0; d < base.nDim; d++) {
+            CVariable *var = &(m_var[base.Varnr[d]]);
+            if (base.Varnr[d] == v) {
+                remap[d] = DestCode;
+                rt.SizeDim[d] = nCode;
+                nValid[d] = nCode - nMissing;
+            }
+            else if (var->HasRecode) {
+                remap[d] = var->Recode.DestCode;
+                rt.SizeDim[d] = var->Recode.nCode;
+                nValid[d] = var->Recode.nCode - var->Recode.nMissing;
+            }
+            else {
+                remap[d] = 0;
+                nValid[d] = var->nCode - var->nMissing;
+            }
+        }
+        if (!ComputeRecodeTable(base, rt, remap)) {
+            delete[] rt.Cell;
+            continue;
+        }
+
+        // the (sub)tables of this table with v
+        for (k = 0; k < m_nUC; k++) {
+            CUCList *u = &(m_UCList[k]);
+            if (!u->biggestThreshold || u->TabNr % m_ntab != i) continue;
+            for (j = 0; j < u->nDim; j++) {
+                if (u->Varnr[j] == v) break;
+            }
+            if (j == u->nDim) continue;
+
+            if (u->nDim == rt.nDim) {
+                UCArray[u->nDim - 1] += CountUnsafeCells(rt, nValid);
+                continue;
+            }
+            CTable st;
+            st.nDim = u->nDim;
+            st.Threshold = u->Threshold;
+            for (j = 0, d = 0; j < u->nDim; j++) {
+                while (rt.Varnr[d] != u->Varnr[j]) d++;
+                st.Varnr[j] = rt.Varnr[d];
+                st.SizeDim[j] = rt.SizeDim[d];
+                subValid[j] = nValid[d];
+            }
+            if (ComputeSubTable(rt, st) > 0) {
+                UCArray[u->nDim - 1] += CountUnsafeCells(st, subValid);
+            }
+            delete[] st.Cell;
+        }
+        delete[] rt.Cell;
+    }
+}
+
+// number of non-zero cells <= Threshold without a missing code,
+// nValid[d]: number of codes of dimension d that are not missing
+long CMuArgCtrl::CountUnsafeCells(CTable & t, const int *nValid)
+{
+    int d, code[MAXDIM];
+    long i, n = 0;
+
+    for (d = 0; d < t.nDim; d++) {
+        code[d] = 0;
+    }
+    for (i = 0; i < t.nCell; i++) {
+        if (t.Cell[i] != 0 && t.Cell[i] <= t.Threshold) {
+            for (d = 0; d < t.nDim; d++) {
+                if (code[d] >= nValid[d]) break;
+            }
+            if (d == t.nDim) {
+                n++;
+            }
+        }
+        // next cell, last dimension runs fastest
+        for (d = t.nDim - 1; d >= 0; d--) {
+            if (++code[d] < t.SizeDim[d]) break;
+            code[d] = 0;
+        }
+    }
+    return n;
+}
+
+// prepares SearchRecode and SearchTruncate of variable v: the (sub)tables of UCList with v
+// (as counted by UnsafeVariable) with the other variables recoded as now,
+// and the frequencies of the codes of v. Returns false if v is in no table
+bool CMuArgCtrl::PrepareRecodeSearch(int v, std::vector<CRecodeSearchTable> &Tables, std::vector<double> &Freq)
+{
+    int i, j, k, d;
+    int *remap[MAXDIM];
+    int nValid[MAXDIM], subValid[MAXDIM];
+
+    Tables.clear();
+    Freq.assign(m_var[v].nCode - m_var[v].nMissing, 0);
+    if (Freq.empty()) {
+        return false;
+    }
+    for (i = 0; i < m_ntab; i++) {
+        CTable &base = m_tab[i];
+        for (d = 0; d < base.nDim; d++) {
+            if (base.Varnr[d] == v) break;
+        }
+        if (d == base.nDim) continue;  // v not in table
+
+        // the base table with the other variables recoded
+        CTable rt = base;
+        bool recoded = false;
+        rt.IsBIR = false;  // only frequencies needed
+        rt.BIRCell = 0;
+        for (d = 0; d < base.nDim; d++) {
+            CVariable *var = &(m_var[base.Varnr[d]]);
+            if (base.Varnr[d] != v && var->HasRecode) {
+                remap[d] = var->Recode.DestCode;
+                rt.SizeDim[d] = var->Recode.nCode;
+                nValid[d] = var->Recode.nCode - var->Recode.nMissing;
+                recoded = true;
+            }
+            else {
+                remap[d] = 0;
+                nValid[d] = var->nCode - var->nMissing;
+            }
+        }
+        if (recoded) {
+            rt.Cell = 0;
+            if (!ComputeRecodeTable(base, rt, remap)) {
+                delete[] rt.Cell;
+                continue;
+            }
+        }
+
+        for (k = 0; k < m_nUC; k++) {
+            CUCList *u = &(m_UCList[k]);
+            if (!u->biggestThreshold || u->TabNr % m_ntab != i) continue;
+            for (j = 0; j < u->nDim; j++) {
+                if (u->Varnr[j] == v) break;
+            }
+            if (j == u->nDim) continue;
+
+            if (u->nDim == rt.nDim) {
+                AddRecodeSearchTable(rt, nValid, v, Tables, Tables.empty() ? &Freq : 0);
+                continue;
+            }
+            CTable st;
+            st.nDim = u->nDim;
+            st.Threshold = u->Threshold;
+            for (j = 0, d = 0; j < u->nDim; j++) {
+                while (rt.Varnr[d] != u->Varnr[j]) d++;
+                st.Varnr[j] = rt.Varnr[d];
+                st.SizeDim[j] = rt.SizeDim[d];
+                subValid[j] = nValid[d];
+            }
+            if (ComputeSubTable(rt, st) > 0) {
+                AddRecodeSearchTable(st, subValid, v, Tables, Tables.empty() ? &Freq : 0);
+            }
+            delete[] st.Cell;
+        }
+        if (recoded) {
+            delete[] rt.Cell;
+        }
+    }
+    return !Tables.empty();
+}
+
+// adds table t with variable v to the tables of SearchRecode, nValid[d]: number of codes
+// of dimension d that are not missing. Adds the frequencies of the codes of v to Freq if not 0
+void CMuArgCtrl::AddRecodeSearchTable(CTable &t, const int *nValid, int v, std::vector<CRecodeSearchTable> &Tables, std::vector<double> *Freq)
+{
+    int d, jv, code[MAXDIM];
+    long i;
 
-    if (nRecodes == 0) { // nothing to do, why do you call me?
-	return false;
+    for (jv = 0; t.Varnr[jv] != v; jv++);
+    Tables.push_back(CRecodeSearchTable());
+    CRecodeSearchTable *s = &(Tables.back());
+    s->Threshold = t.Threshold;
+    s->nRest = 1;
+    for (d = 0; d < t.nDim; d++) {
+        code[d] = 0;
+        if (d != jv) {
+            s->nRest *= nValid[d];
+        }
     }
+    s->Cell.assign((long) nValid[jv] * s->nRest, 0);
 
-    for (i = 0; i < m_ntab; i++) {
-	int nDim = m_tab[i].nDim;
-	for (d = 0; d < nDim; d++) {
-            // a base table with at least one recode?
-            if (m_var[m_tab[i].Varnr[d]].HasRecode) {
-                break;
+    for (i = 0; i < t.nCell; i++) {
+        if (code[jv] < nValid[jv]) {
+            long r = 0;
+            if (Freq != 0) {
+                (*Freq)[code[jv]] += t.Cell[i];
             }
-	}
-	if (d == nDim) continue; // table has no recodes
-	m_tab[i + m_ntab].FreeRecodedTable();
-
-	CTable dsttab = m_tab[i];
-	dsttab.Cell = 0;
-	dsttab.nCell =0;
-	dsttab.BIRCell =0;
-	for (d = 0; d < nDim; d++) {
-            if (m_var[m_tab[i].Varnr[d]].HasRecode) {
-                dsttab.SizeDim[d] = m_var[m_tab[i].Varnr[d] ].Recode.nCode;
+            for (d = 0; d < t.nDim; d++) {
+                if (d == jv) continue;
+                if (code[d] >= nValid[d]) break;
+                r = r * nValid[d] + code[d];
             }
-	}
-
-	// compute and save recoded table
-	ComputeRecodeTable(m_tab[i], dsttab);
-	m_tab[m_ntab + i] = dsttab; // save for later use
-	m_tab[i].HasRecode = true;
-	m_tab[m_ntab + i].HasRecode = false;
+            if (d == t.nDim) {
+                s->Cell[code[jv] * s->nRest + r] = t.Cell[i];
+            }
+        }
+        // next cell, last dimension runs fastest
+        for (d = t.nDim - 1; d >= 0; d--) {
+            if (++code[d] < t.SizeDim[d]) break;
+            code[d] = 0;
+        }
     }
+}
 
-    return true;
+// makes the grouping of SearchRecode with the groups of codes First[g] .. First[g + 1] - 1
+void CMuArgCtrl::MakeRecodeSearchState(const std::vector<CRecodeSearchTable> &Tables, const std::vector<double> &Freq, const std::vector<int> &First, CRecodeSearchState &State)
+{
+    int g, c, t, nGroups = First.size();
+    long r;
+
+    State.First = First;
+    State.Freq.assign(nGroups, 0);
+    State.Cell.resize(Tables.size());
+    State.UC.resize(Tables.size());
+    State.nUnsafe = 0;
+    for (t = 0; t < (int) Tables.size(); t++) {
+        const CRecodeSearchTable *s = &(Tables[t]);
+        State.Cell[t].assign(nGroups * s->nRest, 0);
+        State.UC[t].assign(nGroups, 0);
+        for (g = 0; g < nGroups; g++) {
+            int last = (g + 1 < nGroups) ? First[g + 1] : (int) Freq.size();
+            long *dst = &(State.Cell[t][g * s->nRest]);
+            for (c = First[g]; c < last; c++) {
+                const long *src = &(s->Cell[c * s->nRest]);
+                for (r = 0; r < s->nRest; r++) {
+                    dst[r] += src[r];
+                }
+            }
+            for (r = 0; r < s->nRest; r++) {
+                if (dst[r] != 0 && dst[r] <= s->Threshold) {
+                    State.UC[t][g]++;
+                }
+            }
+            State.nUnsafe += State.UC[t][g];
+        }
+    }
+    for (g = 0; g < nGroups; g++) {
+        int last = (g + 1 < nGroups) ? First[g + 1] : (int) Freq.size();
+        for (c = First[g]; c < last; c++) {
+            State.Freq[g] += Freq[c];
+        }
+    }
 }
 
-bool CMuArgCtrl::ComputeRecodeTable(CTable & srctab, CTable & dsttab)
+// Loss and Cost of a grouping of SearchRecode, Entropy: entropy of the codes before grouping
+void CMuArgCtrl::SetRecodeSearchCost(CRecodeSearchState &State, double Entropy, double LossWeight)
 {
-    if (!dsttab.PrepareTable()) {
-        return false;
+    State.Loss = Entropy - GroupEntropy(State.Freq);
+    if (State.Loss < 0) {  // rounding
+        State.Loss = 0;
     }
-    ComputeRecodeTableCells(srctab, dsttab, 0, 0, 0);
-    return true;
+    State.Cost = State.nUnsafe + LossWeight * State.Loss;
 }
 
-void CMuArgCtrl::ComputeRecodeTableCells(CTable & srctab, CTable & dsttab, int niv, int iCellSrc, int iCellDst)
+// change of the number of unsafe cells if groups g and g + 1 of a grouping are merged
+long CMuArgCtrl::MergeUnsafeDelta(const std::vector<CRecodeSearchTable> &Tables, const CRecodeSearchState &State, int g)
 {
-    int i, desti, nDim = srctab.nDim;
+    long r, delta = 0;
 
-    if (niv == nDim) {
-        assert(iCellSrc >= 0 && iCellSrc < srctab.nCell);
-	assert(iCellDst >= 0 && iCellDst < dsttab.nCell);
-	if (iCellDst == 4088)	{
-            long Ramya = 0;
-	}
-	dsttab.Cell[iCellDst] += srctab.Cell[iCellSrc];
-	if (dsttab.IsBIR) {
-            dsttab.BIRCell[iCellDst] += srctab.BIRCell[iCellSrc];
-	}
-	return;
+    for (int t = 0; t < (int) Tables.size(); t++) {
+        long nRest = Tables[t].nRest, Threshold = Tables[t].Threshold, n = 0;
+        const long *a = &(State.Cell[t][g * nRest]), *b = a + nRest;
+        for (r = 0; r < nRest; r++) {
+            long f = a[r] + b[r];
+            if (f != 0 && f <= Threshold) {
+                n++;
+            }
+        }
+        delta += n - State.UC[t][g] - State.UC[t][g + 1];
     }
+    return delta;
+}
 
-    int iVar = srctab.Varnr[niv];
-    int n = srctab.SizeDim[niv];
+// merges groups g and g + 1 of a grouping, the Cost is not updated
+void CMuArgCtrl::MergeRecodeGroups(const std::vector<CRecodeSearchTable> &Tables, CRecodeSearchState &State, int g)
+{
+    long r;
+
+    State.nUnsafe = 0;
+    for (int t = 0; t < (int) Tables.size(); t++) {
+        long nRest = Tables[t].nRest, Threshold = Tables[t].Threshold;
+        std::vector<long> &Cell = State.Cell[t];
+        long *a = &(Cell[g * nRest]), *b = a + nRest;
+        State.UC[t][g] = 0;
+        for (r = 0; r < nRest; r++) {
+            a[r] += b[r];
+            if (a[r] != 0 && a[r] <= Threshold) {
+                State.UC[t][g]++;
+            }
+        }
+        Cell.erase(Cell.begin() + (g + 1) * nRest, Cell.begin() + (g + 2) * nRest);
+        State.UC[t].erase(State.UC[t].begin() + g + 1);
+        for (r = 0; r < (long) State.UC[t].size(); r++) {
+            State.nUnsafe += State.UC[t][r];
+        }
+    }
+    State.Freq[g] += State.Freq[g + 1];
+    State.Freq.erase(State.Freq.begin() + g + 1);
+    State.First.erase(State.First.begin() + g + 1);
+}
 
-    bool HasRecode = m_var[iVar].HasRecode;
+// entropy in bits of a distribution, see DoEntropy
+double CMuArgCtrl::GroupEntropy(const std::vector<double> &Freq)
+{
+    double N = 0, Entropy = 0;
 
-    for (i = 0; i < n; i++) {
-        if (HasRecode) {
-            desti = m_var[iVar].Recode.DestCode[i];
-            assert(desti >= 0 && desti < m_var[iVar].Recode.nCode);
-	}
-	else {
-            desti = i;
-	}
-    
-        ComputeRecodeTableCells(srctab, dsttab, niv + 1, iCellSrc * srctab.SizeDim[niv] + i, iCellDst * dsttab.SizeDim[niv] + desti);
+    for (int g = 0; g < (int) Freq.size(); g++) {
+        if (Freq[g] > 0) {  // avoid log(0)
+            Entropy += Freq[g] * log(Freq[g]);
+            N += Freq[g];
+        }
+    }
+    if (N <= 0) {
+        return 0;
     }
+    return log(N) / log(2.0) - Entropy / (N * log(2.0));
 }
 
+// recode specification of variable v grouping the codes First[g] .. First[g + 1] - 1, see DoRecode.
+// A group of more than one code gets its first code, other codes are left untouched
+std::string CMuArgCtrl::MakeGroupRecodeString(int v, const std::vector<int> &First)
+{
+    CVariable *var = &(m_var[v]);
+    int g, nGroups = First.size(), nCode = var->nCode - var->nMissing;
+    std::string s;
+
+    for (g = 0; g < nGroups; g++) {
+        int last = ((g + 1 < nGroups) ? First[g + 1] : nCode) - 1;
+        if (last == First[g]) continue;
+        std::string code[2];
+        for (int k = 0; k < 2; k++) {
+            std::string c = var->sCode[k == 0 ? First[g] : last];
+            c.erase(0, c.find_first_not_of(' '));  // spaces before are added again
+            if (c.find_first_of(" ,-:") != std::string::npos) {
+                c = "\"" + c + "\"";
+            }
+            code[k] = c;
+        }
+        s += code[0] + ": " + code[0] + "-" + code[1] + SEPARATOR;
+    }
+    return s;
+}
 
 bool CMuArgCtrl::WriteVariablesInFile(std::string FileNameMicro, std::string FileNameOut, long nVar, long *VarIndexes, std::string seperator, long *ErrorCode)
 {
@@ -2588,6 +4563,10 @@ bool CMuArgCtrl::WriteVariablesInFile(std::string FileNameMicro, std::string Fil
 	return false;
     }
 
+    // a grouped household file: the records in the order MakeFileSafe reads them back, see SetHouseholdGrouping
+    if (m_FileGrouped) {
+        sFileNameMicro = m_fname;
+    }
     fd = fopen(sFileNameMicro.c_str(), "r");
     if (fd == 0) {
         *ErrorCode = FILENOTFOUND;
@@ -2795,7 +4774,6 @@ bool CMuArgCtrl::SetNumberOfChangeFiles(long nFiles)
  */
 bool CMuArgCtrl::SetBirThreshold(long TabIndex, double Threshold, long *nUnsafe)
 {
-    double Ksi;
     int i = TabIndex - 1;
 
     if (i < 0 || i >= m_ntab || !m_tab[i].IsBIR){
@@ -2815,15 +4793,55 @@ bool CMuArgCtrl::SetBirThreshold(long TabIndex, double Threshold, long *nUnsafe)
 	}
     }
 
-    // compute nUC
-    t->BIRUnsafe = 0;
-    int DimNr[MAXDIM];
-    AddMissingTable(*t, 0, DimNr, false, BIR_UNSAFE, &Ksi, 0);
+    // compute nUC: the records in the cells with a log risk >= Threshold
+    CBIRCells &c = FindBIRIndex(*t);
+    long n = c.SortLogRisk.size();
+    long k = std::lower_bound(c.SortLogRisk.begin(), c.SortLogRisk.end(), Threshold) - c.SortLogRisk.begin();
+    t->BIRUnsafe = c.CumCell[n] - c.CumCell[k];
     *nUnsafe = t->BIRUnsafe;
 
     return true;
 }
 
+/**
+ * Finds the highest threshold (see SetBirThreshold) with at least nUnsafe unsafe records
+ * @param TabIndex      1, 2, ..., n_tab index of table
+ * @param nUnsafe       Number of unsafe records wanted
+ * @param Threshold     The threshold, the log risk of a cell
+ * @param nUnsafeFound  Number of unsafe records with this threshold, >= nUnsafe
+ * @return false if TabIndex is incorrect, nUnsafe <= 0 or more than the records with a risk
+ */
+bool CMuArgCtrl::FindBIRThreshold(long TabIndex, long nUnsafe, double *Threshold, long *nUnsafeFound)
+{
+    int i = TabIndex - 1;
+
+    if (i < 0 || i >= m_ntab || !m_tab[i].IsBIR || nUnsafe <= 0){
+	return false;
+    }
+
+    CTable *t = &(m_tab[i]);
+    if (t->HasRecode) {
+	t = &(m_tab[m_ntab + i]); // take the recoded one
+    }
+    if (t->Cell == 0) {
+        return false;
+    }
+
+    CBIRCells &c = FindBIRIndex(*t);
+    long n = c.SortLogRisk.size();
+    if (nUnsafe > c.CumCell[n]) {
+        return false;
+    }
+
+    // last cell k with at least nUnsafe records in the cells k, ..., n - 1
+    long k = std::upper_bound(c.CumCell.begin(), c.CumCell.begin() + n, c.CumCell[n] - nUnsafe) - c.CumCell.begin() - 1;
+    *Threshold = c.SortLogRisk[k];
+    k = std::lower_bound(c.SortLogRisk.begin(), c.SortLogRisk.end(), *Threshold) - c.SortLogRisk.begin();
+    *nUnsafeFound = c.CumCell[n] - c.CumCell[k];
+
+    return true;
+}
+
 /**
  * Sets for a given numerical variable the code to be used to replace all values above 
  * a certain value. E.g., all values above 600,000 receive the text ">=600,000"
@@ -3021,23 +5039,24 @@ bool CMuArgCtrl::SetPramValue(long CodeIndex, long Value)
  */
 bool CMuArgCtrl::GetTableUC(long nDim, long Index, bool *BaseTable, long *nUC, long *VarList)
 {
-    int i, d = 0;
-    CUCList uc;
-
     if (m_nvar == 0 || m_ntab == 0 || m_fname[0] == 0) {
 	return false;
     }
+    if (nDim < 1 || nDim > MAXDIM) {
+	return false;
+    }
+    if (Index < 1 || Index > (long) m_UCDimList[nDim].size()) {
+//    *pVal = VARIANT_FALSE;
+	return false;
+    }
 
-    for (i = 0; i < m_nUC; i++) {
-	uc = m_UCList[i];
-	if (!uc.biggestThreshold) continue;
-	if (uc.nDim == nDim) {
-            if (++d == Index) { // that's the one
-                *BaseTable = (nDim == m_tab[uc.TabNr].nDim);
-		*nUC = uc.nUC;
-		for (int j = 0; j < nDim; j++) {
-                    VarList[j] = uc.Varnr[j] + 1;
-		}
+    // that's the one
+    CUCList &uc = m_UCList[m_UCDimList[nDim][Index - 1]];
+    *BaseTable = (nDim == m_tab[uc.TabNr].nDim);
+    *nUC = uc.nUC;
+    for (int j = 0; j < nDim; j++) {
+        VarList[j] = uc.Varnr[j] + 1;
+    }
 /*#ifdef _DEBUGG
         TRACE("nDim=%d, Index=%3d, Base=%d, nUc=%d VarIndices:", nDim, Index, *BaseTable, *nUC);
         for (j = 0; j < nDim; j++) {
@@ -3045,12 +5064,103 @@ bool CMuArgCtrl::GetTableUC(long nDim, long Index, bool *BaseTable, long *nUC, l
         }
         TRACE("\n");
 #endif // _DEBUGG */
-		return true;
+    return true;
+}
+
+/**
+ * Enumerates the unsafe cells of a table in chunks, as code indices plus frequency
+ * A cell is unsafe if 0 < freq <= threshold and none of its codes is a missing code, as counted in nUC
+ * @param nDim          Number of dimensions of the table, as in GetTableUC,
+ *                      or 0: Index is the index of a permanent table (see SetTable)
+ * @param Index         1, 2, ... index of the table, as in GetTableUC
+ * @param StartCell     0 for the first call, then NextCell of the previous call
+ * @param MaxCells      maximum number of unsafe cells returned in this call
+ * @param nCells        number of unsafe cells returned
+ * @param CodeArray     per unsafe cell nDim code indices (1, 2, ...), at least MaxCells * nDim elements
+ * @param FreqArray     per unsafe cell the frequency, at least MaxCells elements
+ * @param WeightArray   per unsafe cell the sum of weights for BIR tables, 0 otherwise, at least MaxCells elements
+ * @param NextCell      StartCell for the next call, -1 if all cells are done
+ * @return false if one or more parameters is wrong
+ */
+bool CMuArgCtrl::GetUnsafeCells(long nDim, long Index, long StartCell, long MaxCells, long *nCells, long *CodeArray, long *FreqArray, double *WeightArray, long *NextCell)
+{
+    int d, NMis[MAXDIM], code[MAXDIM];
+    long c, n = 0;
+    CTable *t;
+
+    if (m_nvar == 0 || m_ntab == 0 || m_fname[0] == 0 || m_UCList == 0) {
+	return false;
+    }
+    if (MaxCells < 1 || StartCell < 0) {
+	return false;
+    }
+
+    if (nDim == 0) {  // permanent table
+        if (Index < 1 || Index > m_ntab) {
+            return false;
+        }
+        if (m_tab[Index - 1].HasRecode) {
+            t = &(m_tab[Index - 1 + m_ntab]);
+        }
+        else {
+            t = &(m_tab[Index - 1]);
+        }
+    }
+    else {
+        if (nDim < 1 || nDim > MAXDIM) {
+            return false;
+        }
+        if (Index < 1 || Index > (long) m_UCDimList[nDim].size()) {
+            return false;
+        }
+        CUCList *u = &(m_UCList[m_UCDimList[nDim][Index - 1]]);
+        if (u->nDim == m_tab[u->TabNr].nDim) {  // base table
+            t = &(m_tab[u->TabNr]);
+        }
+        else {
+            t = &(u->table);
+        }
+        if (u->Pruned) {  // no unsafe cells, cells maybe not computed
+            *nCells = 0;
+            *NextCell = -1;
+            return true;
+        }
+    }
+
+    // first missing code and code indices of StartCell
+    c = StartCell;
+    for (d = t->nDim - 1; d >= 0; d--) {
+        CVariable *var = &(m_var[t->Varnr[d]]);
+        NMis[d] = var->GetnCodes(true) - (var->HasRecode ? var->Recode.nMissing : var->nMissing);
+        code[d] = c % t->SizeDim[d];
+        c /= t->SizeDim[d];
+    }
+
+    for (c = StartCell; c < t->nCell && n < MaxCells; c++) {
+        long freq = t->Cell[c];
+        if (freq != 0 && freq <= t->Threshold) {
+            for (d = 0; d < t->nDim; d++) {
+                if (code[d] >= NMis[d]) break;
             }
-	}
+            if (d == t->nDim) {  // no missing code
+                for (d = 0; d < t->nDim; d++) {
+                    CodeArray[n * t->nDim + d] = code[d] + 1;
+                }
+                FreqArray[n] = freq;
+                WeightArray[n] = t->IsBIR ? t->BIRCell[c] : 0;
+                n++;
+            }
+        }
+        // next code combination, last variable fastest
+        for (d = t->nDim - 1; d >= 0; d--) {
+            if (++code[d] < t->SizeDim[d]) break;
+            code[d] = 0;
+        }
     }
-//    *pVal = VARIANT_FALSE;
-    return false;
+
+    *nCells = n;
+    *NextCell = (c < t->nCell) ? c : -1;
+    return true;
 }
 
 bool CMuArgCtrl::GetErrorString(long errorCode, const char ** errorString) {
@@ -3107,6 +5217,9 @@ bool CMuArgCtrl::GetErrorString(long errorCode, const char ** errorString) {
         case E_EMPTYSPEC:
             str = "Empty specification";
             break;
+        case E_NOTNESTED:
+            str = "Codes of the previous level are not grouped";
+            break;
     }
     *errorString = str.c_str();
     return true;
@@ -3351,7 +5464,7 @@ bool CMuArgCtrl::MakeFileSafeClearOptions()
 bool CMuArgCtrl::ComputeBIRRateThreshold(long TabIndex, double MaxRisk, double *ReIdentRate)
 {
 //	AFX_MANAGE_STATE(AfxGetStaticModuleState())
-    int i = TabIndex - 1, DimNr[MAXDIM];
+    int i = TabIndex - 1;
 
     if (i < 0 || i >= m_ntab)	{
 	return false;
@@ -3365,13 +5478,150 @@ bool CMuArgCtrl::ComputeBIRRateThreshold(long TabIndex, double MaxRisk, double *
 	t = &(m_tab[m_ntab + i]); // take the recoded one
     }
 
-    AddMissingTable(*t, 0, DimNr, false, BIR_RATE_RISK, ReIdentRate, MaxRisk); // computes m_BIRMaxValue and m_BIRMinValue
+    // the cells with a risk above MaxRisk count with MaxRisk
+    CBIRCells &c = FindBIRIndex(*t);
+    long n = c.SortRisk.size();
+    long k = std::upper_bound(c.SortRisk.begin(), c.SortRisk.end(), MaxRisk) - c.SortRisk.begin();
+    *ReIdentRate = c.CumFreqRisk[k] + (c.CumFreq[n] - c.CumFreq[k]) * MaxRisk;
 
     *ReIdentRate = *ReIdentRate / m_NumberofRecs;
 
     return true;
 }
 
+/**
+ * Finds the maximum risk for which ComputeBIRRateThreshold gives the re-identification rate ReIdentRate
+ * @param TabIndex      1, 2, ..., n_tab index of table
+ * @param ReIdentRate   Re-identification rate wanted
+ * @param MaxRisk       The maximum risk of a cell
+ * @return false if TabIndex is incorrect or the rate cannot be reached
+ */
+bool CMuArgCtrl::FindBIRMaxRisk(long TabIndex, double ReIdentRate, double *MaxRisk)
+{
+    int i = TabIndex - 1;
+
+    if (i < 0 || i >= m_ntab || !m_tab[i].IsBIR || ReIdentRate < 0) {
+	return false;
+    }
+
+    CTable *t = &(m_tab[i]);
+    if (t->HasRecode) {
+	t = &(m_tab[m_ntab + i]); // take the recoded one
+    }
+    if (t->Cell == 0) {
+        return false;
+    }
+
+    CBIRCells &c = FindBIRIndex(*t);
+    long n = c.SortRisk.size(), first = 0, last = n - 1;
+    double x = ReIdentRate * m_NumberofRecs;
+    if (n == 0 || x > c.CumFreqRisk[n]) {
+        return false;
+    }
+
+    // the rate grows linear between the risks of the cells: find the first cell k with a
+    // rate >= ReIdentRate at its risk, MaxRisk is between the risks of cell k - 1 and k
+    while (first < last) {
+        long k = (first + last) / 2;
+        if (c.CumFreqRisk[k] + (c.CumFreq[n] - c.CumFreq[k]) * c.SortRisk[k] >= x) {
+            last = k;
+        }
+        else {
+            first = k + 1;
+        }
+    }
+    *MaxRisk = (x - c.CumFreqRisk[first]) / (c.CumFreq[n] - c.CumFreq[first]);
+    if (*MaxRisk > c.SortRisk[first]) *MaxRisk = c.SortRisk[first];  // rounding
+    if (*MaxRisk < 0) *MaxRisk = 0;
+
+    return true;
+}
+
+/**
+ * Computes for many thresholds the number of unsafe records, as SetBirThreshold does,
+ * without setting the threshold. The thresholds and the sorted risks of the cells are
+ * merged in one sweep.
+ * @param TabIndex          1, 2, ..., n_tab index of table
+ * @param nThresholds       Number of thresholds
+ * @param ThresholdArray    The thresholds, log risks, in any order
+ * @param nUnsafeArray      Per threshold the number of unsafe records
+ * @return false if TabIndex is incorrect or the table is not computed
+ */
+bool CMuArgCtrl::ComputeBIRUnsafeCurve(long TabIndex, long nThresholds, double *ThresholdArray, long *nUnsafeArray)
+{
+    int i = TabIndex - 1;
+
+    if (i < 0 || i >= m_ntab || !m_tab[i].IsBIR || nThresholds < 0) {
+	return false;
+    }
+
+    CTable *t = &(m_tab[i]);
+    if (t->HasRecode) {
+	t = &(m_tab[m_ntab + i]); // take the recoded one
+    }
+    if (t->Cell == 0) {
+        return false;
+    }
+
+    CBIRCells &c = FindBIRIndex(*t);
+    long j, k = 0, n = c.SortLogRisk.size();
+    std::vector<long> Order(nThresholds);
+    for (j = 0; j < nThresholds; j++) {
+        Order[j] = j;
+    }
+    std::sort(Order.begin(), Order.end(), CRiskIndexLess(ThresholdArray));
+
+    for (j = 0; j < nThresholds; j++) {
+        double Threshold = ThresholdArray[Order[j]];
+        while (k < n && c.SortLogRisk[k] < Threshold) k++;
+        nUnsafeArray[Order[j]] = c.CumCell[n] - c.CumCell[k];
+    }
+
+    return true;
+}
+
+/**
+ * Computes for many maximum risks the re-identification rate, as ComputeBIRRateThreshold
+ * does. The risks and the sorted risks of the cells are merged in one sweep.
+ * @param TabIndex          1, 2, ..., n_tab index of table
+ * @param nRisks            Number of maximum risks
+ * @param MaxRiskArray      The maximum risks, in any order
+ * @param ReIdentRateArray  Per maximum risk the re-identification rate
+ * @return false if TabIndex is incorrect or the table is not computed
+ */
+bool CMuArgCtrl::ComputeBIRRateCurve(long TabIndex, long nRisks, double *MaxRiskArray, double *ReIdentRateArray)
+{
+    int i = TabIndex - 1;
+
+    if (i < 0 || i >= m_ntab || !m_tab[i].IsBIR || nRisks < 0) {
+	return false;
+    }
+
+    CTable *t = &(m_tab[i]);
+    if (t->HasRecode) {
+	t = &(m_tab[m_ntab + i]); // take the recoded one
+    }
+    if (t->Cell == 0) {
+        return false;
+    }
+
+    CBIRCells &c = FindBIRIndex(*t);
+    long j, k = 0, n = c.SortRisk.size();
+    std::vector<long> Order(nRisks);
+    for (j = 0; j < nRisks; j++) {
+        Order[j] = j;
+    }
+    std::sort(Order.begin(), Order.end(), CRiskIndexLess(MaxRiskArray));
+
+    for (j = 0; j < nRisks; j++) {
+        double MaxRisk = MaxRiskArray[Order[j]];
+        while (k < n && c.SortRisk[k] <= MaxRisk) k++;
+        ReIdentRateArray[Order[j]] = (c.CumFreqRisk[k] + (c.CumFreq[n] - c.CumFreq[k]) * MaxRisk) / m_NumberofRecs;
+    }
+
+    return true;
+}
+
 /**
  * Histogram gives information about the BaseIndividualRisk base. 
  * This is the natural logarithm of the result of that function.
@@ -3384,7 +5634,7 @@ bool CMuArgCtrl::ComputeBIRRateThreshold(long TabIndex, double MaxRisk, double *
  */
 bool CMuArgCtrl::GetBIRHistogramData(long TabIndex, long nClasses, double *ClassLeftValue, double *Ksi, long *Frequency)
 {
-    int i = TabIndex - 1, k, DimNr[MAXDIM];
+    int i = TabIndex - 1, k;
 
     if (i < 0 || i >= m_ntab)	{
 	return false;
@@ -3402,10 +5652,15 @@ bool CMuArgCtrl::GetBIRHistogramData(long TabIndex, long nClasses, double *Class
     }
 
     // compute min and max risk
+    CBIRCells &c = FindBIRIndex(*t);
+    long n = c.SortLogRisk.size();
     t->BIRMaxValue = -DBL_MAX;
     t->BIRMinValue = DBL_MAX;
     t->BIRnClasses = nClasses;
-    AddMissingTable(*t, 0, DimNr, false, BIR_MINMAX, Ksi, 0); // computes m_BIRMaxValue and m_BIRMinValue
+    if (n > 0) {
+        t->BIRMinValue = c.SortLogRisk[0];
+        t->BIRMaxValue = c.SortLogRisk[n - 1];
+    }
 
     // compute class width
     t->BIRClassWidth= (t->BIRMaxValue - t->BIRMinValue) / nClasses;
@@ -3421,8 +5676,14 @@ bool CMuArgCtrl::GetBIRHistogramData(long TabIndex, long nClasses, double *Class
         Frequency[k] = 0;
     }
 
-    *Ksi = 0;
-    AddMissingTable(*t, 0, DimNr, false, BIR_FREQ, Ksi, 0, Frequency); // computes frequencies
+    std::vector<long> Start;
+    HistogramClassStart(c.SortLogRisk, t->BIRMinValue, t->BIRClassWidth, nClasses, Start);
+    for (k = 0; k < nClasses; k++) {
+        Frequency[k] = c.CumFreq[Start[k + 1]] - c.CumFreq[Start[k]];
+    }
+
+    // hier tellen voor de Re-indent.rate
+    *Ksi = c.CumFreqRisk[n];
     *Ksi = *Ksi / m_NumberofRecs;
 /*
 #ifdef _DEBUGG
@@ -3433,82 +5694,14 @@ bool CMuArgCtrl::GetBIRHistogramData(long TabIndex, long nClasses, double *Class
     }
     TRACE("Frequencies:\n");
     for (i = 0; i < nClasses; i++) {
-      TRACE("%2d. %5d\n", i + 1, Frequency[i]);
-    }
-  }
-#endif _DEBUG
-*/
-    return true;
-}
-
-bool CMuArgCtrl::AddMissingTable(CTable & t, int niv, int *DimNr, bool HasMissing, int type, double *Ksi, double MaxRisk, long *Frequency)
-{
-    int i, nMissing, nCode;
-    bool temp;
-    if (niv == t.nDim) {
-        long freq = t.Cell[t.GetCellNr(DimNr)];
-	double weight, v, Logv;
-	if (freq > 0) {
-            AddMissing(t, DimNr, freq, weight, HasMissing); // all corresponding Missing(s) are added
-            temp = BaseIndividualRisk(freq, weight, &v);
-            assert(temp);
-            if (v != 0) {
-	  	// take log of it
-                Logv = log(v);
-		switch (type) {
-                    case BIR_MINMAX:
-			if (Logv > t.BIRMaxValue) t.BIRMaxValue = Logv;
-			if (Logv < t.BIRMinValue) t.BIRMinValue = Logv;
-			break;
-                    case BIR_FREQ:
-			assert(Logv <= t.BIRMaxValue && Logv >= t.BIRMinValue);
-			{ 
-                            int ci = (int) ((Logv - t.BIRMinValue) / t.BIRClassWidth);
-                            if (ci == t.BIRnClasses) ci--;  // can happen in rare cases, due to rounding
-                            assert(ci >= 0 && ci < t.BIRnClasses);
-                            Frequency[ci] += freq;
-			}
-			// hier tellen voor de Re-indent.rate
-			*Ksi = *Ksi + freq * v;
-			break;
-			case BIR_UNSAFE:
-                            if (Logv >= t.BIRThreshold) {
-                                t.BIRUnsafe += t.Cell[t.GetCellNr(DimNr)];
-                            }
-                            break;
-			case BIR_RATE_RISK:
-                            if (v > MaxRisk){
-                                *Ksi = *Ksi + freq * MaxRisk;
-                            }
-                            else {
-                                *Ksi = *Ksi + freq * v;
-                            }
-                            break;
-		}
-            }
-	}
-    }
-    else {  // compute all Cells recursively
-        if (m_var[t.Varnr[niv]].HasRecode) {
-            nMissing = m_var[t.Varnr[niv]].Recode.nMissing;
-            nCode = m_var[t.Varnr[niv]].Recode.nCode - nMissing;
-	}
-	else {
-            nMissing = m_var[t.Varnr[niv]].nMissing;
-            nCode = m_var[t.Varnr[niv]].nCode - nMissing;
-	}
-	for (i = 0; i < nCode; i++) { // valid codes
-            DimNr[niv] = i;
-            AddMissingTable(t, niv + 1, DimNr, HasMissing, type, Ksi, MaxRisk, Frequency);
-	}
-	DimNr[niv] = i; // Missing1
-	AddMissingTable(t, niv + 1, DimNr, true, type, Ksi, MaxRisk, Frequency);
+      TRACE("%2d. %5d\n", i + 1, Frequency[i]);
     }
-
+  }
+#endif _DEBUG
+*/
     return true;
 }
 
-
 // DimNr:  array of indices for every dimension
 // HasMissing: true if at least one is an index of a Missing Value
 // Horrendous algorithm stay off it
@@ -3544,16 +5737,10 @@ int CMuArgCtrl::AddMissing(const CTable& tab, int *DimNr, long& freq, double& we
 
 	// now find table with this variables, table has vi dimensions
 	t.nDim = 0;
-	for (i = 0; i < m_nUC; i++) {
-            if (m_UCList[i].nDim != vi) continue;
-            for (j = 0; j < vi; j++) {
-                if (vars[j] != m_UCList[i].Varnr[j]) {
-                    break;
-		}
-            }
-            if (j == vi && m_UCList[i].table.IsBIR) {  // table found!
-            t = m_UCList[i].table;
-            break;
+	for (i = FindUCList(vi, vars); i >= 0; i = m_UCNext[i]) {
+            if (m_UCList[i].table.IsBIR) {  // table found!
+                t = m_UCList[i].table;
+                break;
             }
 	}
 	assert(t.nDim > 0);
@@ -3621,6 +5808,202 @@ void CMuArgCtrl::AddMissingCells(CTable& t, int *dimnr, int *nMissing, long& fre
     }
 }
 
+// the cells of BIR (sub)table t with the missings added and their risk, computed
+// for all cells at the first call after the tables or the recodes changed
+CBIRCells& CMuArgCtrl::FindBIRCells(CTable &t)
+{
+    int i, Missing1[MAXDIM], DimNr[MAXDIM];
+    long CellNr;
+
+    if (!m_BIRCellsValid) {
+        m_BIRCells.clear();
+        m_BIRCellsValid = true;
+    }
+    for (i = 0; i < (int) m_BIRCells.size(); i++) {
+        if (m_BIRCells[i].Cell == t.Cell) return m_BIRCells[i];
+    }
+
+    m_BIRCells.push_back(CBIRCells());
+    CBIRCells &c = m_BIRCells.back();
+    c.Cell = t.Cell;
+    c.Freq.assign(t.nCell, 0);
+    c.Weight.assign(t.nCell, 0);
+    c.Risk.assign(t.nCell, 0);
+    c.State.assign(t.nCell, BIRCELL_NONE);
+
+    for (i = 0; i < t.nDim; i++) {
+        CVariable &var = m_var[t.Varnr[i]];
+        if (var.HasRecode) {
+            Missing1[i] = var.Recode.nCode - var.Recode.nMissing;
+        }
+        else {
+            Missing1[i] = var.nCode - var.nMissing;
+        }
+        DimNr[i] = 0;
+    }
+
+    // DimNr follows CellNr, last dimension fastest (see CTable::GetCellNr)
+    for (CellNr = 0; CellNr < t.nCell; CellNr++) {
+        if (CellNr > 0) {
+            for (i = t.nDim - 1; ++DimNr[i] == t.SizeDim[i]; i--) {
+                DimNr[i] = 0;
+            }
+        }
+        if (t.Cell[CellNr] <= 0) continue;
+
+        bool HasMissing = false, HasMissing2 = false;
+        for (i = 0; i < t.nDim; i++) {
+            if (DimNr[i] == Missing1[i]) HasMissing = true;
+            if (DimNr[i] > Missing1[i]) HasMissing2 = true;
+        }
+        if (HasMissing2) continue;  // left to AddMissing
+
+        long freq = t.Cell[CellNr];
+        double weight;
+        if (!AddMissing(t, DimNr, freq, weight, HasMissing)) {
+            c.State[CellNr] = BIRCELL_ALLMISSING;
+            continue;
+        }
+        c.Freq[CellNr] = freq;
+        c.Weight[CellNr] = weight;
+        c.State[CellNr] = HasMissing ? BIRCELL_MISSING : BIRCELL_VALID;
+    }
+
+    // the risks of all cells at once, empty ones get 0, a cell with weight 0 too
+    // (as BaseIndividualRisk per cell) without losing the risks of the others
+    bool temp = BaseIndividualRiskArray(t.nCell, &c.Freq[0], &c.Weight[0], &c.Risk[0], true);
+    assert(temp);
+
+    return c;
+}
+
+// frequency and weight of cell DimNr of BIR (sub)table t with all corresponding
+// missings added, and its individual risk. False if all variables on Missing
+bool CMuArgCtrl::GetCellBIR(CTable &t, int *DimNr, bool HasMissing, long& freq, double& weight, double& risk)
+{
+    CBIRCells &c = FindBIRCells(t);
+    long CellNr = t.GetCellNr(DimNr);
+    int State = c.State[CellNr];
+
+    if (State == BIRCELL_NONE || (State != BIRCELL_VALID) != HasMissing) {
+        // not precomputed this way, e.g., a Missing2 or a code recoded into Missing1
+        freq = t.Cell[CellNr];
+        if (!AddMissing(t, DimNr, freq, weight, HasMissing)) return false;
+        bool temp = BaseIndividualRisk(freq, weight, &risk);
+        assert(temp);
+        return true;
+    }
+    if (State == BIRCELL_ALLMISSING) return false;
+
+    freq = c.Freq[CellNr];
+    weight = c.Weight[CellNr];
+    risk = c.Risk[CellNr];
+    return true;
+}
+
+// the cells of BIR table t (see FindBIRCells) with a risk, sorted on the risk with prefix
+// sums, so thresholds, unsafe records and rates need a binary search only
+CBIRCells& CMuArgCtrl::FindBIRIndex(CTable &t)
+{
+    CBIRCells &c = FindBIRCells(t);
+    long i, k, n;
+
+    if (c.Sorted) {
+        return c;
+    }
+
+    std::vector<long> CellNr;
+    for (i = 0; i < t.nCell; i++) {
+        if ((c.State[i] == BIRCELL_VALID || c.State[i] == BIRCELL_MISSING) && c.Risk[i] != 0) {
+            CellNr.push_back(i);
+        }
+    }
+    std::sort(CellNr.begin(), CellNr.end(), CRiskIndexLess(&c.Risk[0]));
+
+    n = CellNr.size();
+    c.SortRisk.resize(n);
+    c.SortLogRisk.resize(n);
+    c.SortFreq.resize(n);
+    c.CumCell.assign(n + 1, 0);
+    c.CumFreq.assign(n + 1, 0);
+    c.CumFreqRisk.assign(n + 1, 0);
+    for (k = 0; k < n; k++) {
+        i = CellNr[k];
+        c.SortRisk[k] = c.Risk[i];
+        c.SortLogRisk[k] = log(c.Risk[i]);
+        c.SortFreq[k] = c.Freq[i];
+        c.CumCell[k + 1] = c.CumCell[k] + t.Cell[i];
+        c.CumFreq[k + 1] = c.CumFreq[k] + c.Freq[i];
+        c.CumFreqRisk[k + 1] = c.CumFreqRisk[k] + c.Freq[i] * c.Risk[i];
+    }
+    c.Sorted = true;
+
+    return c;
+}
+
+// the households sorted on their BHR for the BIR table with number BIRCounter among
+// the BIR tables, computed at the first call after CalculateBaseHouseholdRisk
+CBHRIndex& CMuArgCtrl::FindBHRIndex(long BIRCounter)
+{
+    long i, k;
+
+    if ((long) m_BHRIndex.size() <= BIRCounter) {
+        m_BHRIndex.resize(BIRCounter + 1);
+    }
+    CBHRIndex &h = m_BHRIndex[BIRCounter];
+    if (!h.CumRec.empty()) {
+        return h;
+    }
+
+    std::vector<double> BHR(m_lNumberOfHH);
+    std::vector<long> HH(m_lNumberOfHH);
+    for (i = 0; i < m_lNumberOfHH; i++) {
+        BHR[i] = m_HH.m_BHR[BIRCounter][i];
+        HH[i] = i;
+    }
+    std::sort(HH.begin(), HH.end(), CRiskIndexLess(&BHR[0]));
+
+    h.SortBHR.resize(m_lNumberOfHH);
+    h.SortLogBHR.resize(m_lNumberOfHH);
+    h.CumRec.assign(m_lNumberOfHH + 1, 0);
+    for (k = 0; k < m_lNumberOfHH; k++) {
+        i = HH[k];
+        h.SortBHR[k] = BHR[i];
+        h.SortLogBHR[k] = log(BHR[i]);
+        h.CumRec[k + 1] = h.CumRec[k] + m_HH.m_NumberofMembers[i];
+    }
+
+    return h;
+}
+
+// for a histogram of the ascending values x with nClasses classes of ClassWidth from MinValue:
+// Start[k] the first value in class k or higher, Start[nClasses] the number of values.
+// A value is in class (x - MinValue) / ClassWidth, the highest one in the last class
+void CMuArgCtrl::HistogramClassStart(const std::vector<double> &x, double MinValue, double ClassWidth, long nClasses, std::vector<long> &Start)
+{
+    long k, n = x.size();
+
+    Start.assign(nClasses + 1, n);
+    Start[0] = 0;
+    if (!(ClassWidth > 0)) {
+        return;  // all values equal, in the first class
+    }
+    for (k = 1; k < nClasses; k++) {
+        // the class of a value grows with the value: binary search the first one in class k
+        long first = Start[k - 1], last = n;
+        while (first < last) {
+            long mid = (first + last) / 2;
+            if ((long) ((x[mid] - MinValue) / ClassWidth) >= k) {
+                last = mid;
+            }
+            else {
+                first = mid + 1;
+            }
+        }
+        Start[k] = first;
+    }
+}
+
 /**
  * Creates a safe file:
  *      If requested, calculates the entropy of categorical variables 
@@ -3649,12 +6032,11 @@ bool CMuArgCtrl::MakeFileSafe(std::string FileName, bool WithPrior, bool WithEnt
 {
     std::string sFileName;
     sFileName = FileName;
-    FILE *fd_in, *fd_out;
+    FILE *fd_in, *fd_out, *fd_safe;
     char str[MAXRECORDLENGTH];
-    char orgstr[MAXRECORDLENGTH];
-    int i, j, recnr, nRecHH = 1;
-    int* InvolvedVar;
+    int i, j, recnr;
     bool bPrintBHR;
+    CSafeFileBlock Block;
     if (PrintBHR)	{
     	if ((m_lNumBIRs <= 0)  && (m_lNumberOfHH <= 0)) {
             return false;
@@ -3676,8 +6058,6 @@ bool CMuArgCtrl::MakeFileSafe(std::string FileName, bool WithPrior, bool WithEnt
 
     m_HHSeqNr = 0;
 
-    InvolvedVar = new int[m_HHVars.size()];
-
     if (m_nvar == 0 || m_ntab == 0 || m_fname[0] == 0) {
 	return false;
     }
@@ -3725,6 +6105,15 @@ bool CMuArgCtrl::MakeFileSafe(std::string FileName, bool WithPrior, bool WithEnt
     if (fd_out == 0) {
 	return false;
     }
+    // from a grouped copy of the data file: the records are restored to the order of the data file at the end
+    fd_safe = fd_out;
+    if (m_GroupSeqFile != 0 && !m_WriteRandom) {
+        fd_out = tmpfile();
+        if (fd_out == 0) {
+            fclose(fd_safe);
+            return false;
+        }
+    }
 
     if (m_OutFileIsFixedFormat) {
     	MakeRecordDescription( HHIdentOption); // If FileName empty: no *.rda written
@@ -3757,6 +6146,16 @@ bool CMuArgCtrl::MakeFileSafe(std::string FileName, bool WithPrior, bool WithEnt
         m_UCList[i].HasPram = (j != m_UCList[i].nDim);  // a table with a pram variable, make irrelevant
     }
 
+    // the risks of the BIR cells are computed here, the threads of MakeBlockSafe only read them
+    for (i = 0; i < m_nUC; i++) {
+        CUCList *u = &(m_UCList[i]);
+        if (!u->biggestThreshold || u->HasPram) continue;
+        CTable &t = (u->nDim == m_tab[u->TabNr].nDim) ? m_tab[u->TabNr] : u->table;
+        if (t.IsBIR) {
+            FindBIRCells(t);
+        }
+    }
+
 
 /*
 #ifdef SHOWUNSAFE
@@ -3770,6 +6169,7 @@ bool CMuArgCtrl::MakeFileSafe(std::string FileName, bool WithPrior, bool WithEnt
     recnr = 0;
     int ReadCode;
 
+    // the records are read in blocks of whole households, see MakeBlockSafe and WriteBlock
     if (HHIdentOption == HHIDENT_NO) { // no householdrecords
 	while (1) {
             if (ReadCode = ReadMicroRecord(fd_in, str), ReadCode != INFILE_OKE) {
@@ -3787,26 +6187,27 @@ bool CMuArgCtrl::MakeFileSafe(std::string FileName, bool WithPrior, bool WithEnt
                 }
                 continue;
             }
-            strcpy((char *)orgstr,(char *)str);
-            if (!MakeRecordSafe(str, 0, recnr, 1, -1) ) { // Households are not a problem
-                goto error;
+            Block.AddHousehold(-1, 1);  // Households are not a problem
+            Block.AddRecord(str, recnr);
+            if (Block.nRec >= SAFEFILEBLOCK) {
+                if (!MakeBlockSafe(Block)) {
+                    goto error;
+                }
+                WriteBlock(fd_out, Block, HHIdentOption, bPrintBHR);
+                Block.Clear();
             }
-                // now replace the string with some stuff
-            WriteRecord(fd_out, str, HHIdentOption, recnr, false, 0, bPrintBHR,orgstr);
         }
     }
     else { // HHvar is activated, varnr in m_HHIdentVar
         char CurrHH[MAXCODEWIDTH];           // current household ident
 	char PrevHH[MAXCODEWIDTH] = "";      // previous houshold ident
-	long RecPos, StartHHPos = 0;
 	int bPos = m_var[m_HHIdentVar].bPos;
 	int nPos = m_var[m_HHIdentVar].nPos;
-	int FirstRecHH = true, nRecHH;
+	long HHSeqNr = 0;
 
 	CurrHH[nPos] = 0;
         
         while (1) {
-            RecPos = ftell(fd_in);
             if (ReadCode = ReadMicroRecord(fd_in, str), ReadCode != INFILE_OKE) {
                 assert(ReadCode != INFILE_ERROR);
 		if (ReadCode == INFILE_ERROR) {
@@ -3829,52 +6230,47 @@ bool CMuArgCtrl::MakeFileSafe(std::string FileName, bool WithPrior, bool WithEnt
             }
             strncpy(CurrHH, (char *) (&str[bPos]), nPos);
             if (ReadCode == INFILE_EOF || strncmp(CurrHH, PrevHH, nPos) != 0) {  // new HH
-                if (PrevHH[0] != 0) {   // do now the complete HH
-                    long TempRecPos = ftell(fd_in);      // remember current position
-                    m_HHSeqNr++;
-                    //here you have to save the file
-                    DoCompleteHH(fd_in, fd_out, StartHHPos, nRecHH, InvolvedVar, recnr, HHIdentOption, /*HHcount-1*/ m_HHSeqNr-1, bPrintBHR);   // do the HH
-                    fseek(fd_in, TempRecPos, SEEK_SET);  // set at current position
-                    FirstRecHH = true;
+                if (PrevHH[0] != 0) {   // previous HH complete
+                    HHSeqNr++;
                 }
-		strncpy(PrevHH, CurrHH, nPos);
-		StartHHPos = RecPos;
-		for (int v = 0; v < m_HHVars.size(); v++) {
-                    InvolvedVar[v] = false;
-		}
-            }
-            if (ReadCode == INFILE_EOF) break;
-
-            if (FirstRecHH) {
-                long cpos = ftell(fd_in);
-		fseek(fd_in, StartHHPos, SEEK_SET);
-		nRecHH = ComputeRecHH(fd_in, bPos, nPos);
-		assert(nRecHH > 0);
-		fseek(fd_in, cpos, SEEK_SET);
-		FirstRecHH = false;
-            }
+                if (Block.nRec >= SAFEFILEBLOCK || ReadCode == INFILE_EOF) {  // do now the complete HHs
+                    if (!MakeBlockSafe(Block)) {
+                        goto error;
+                    }
+                    WriteBlock(fd_out, Block, HHIdentOption, bPrintBHR);
+                    Block.Clear();
+                }
+                if (ReadCode == INFILE_EOF) break;
 
-            if (!MakeRecordSafe(str, 0, recnr, nRecHH,m_HHSeqNr) ) {
-                goto error;
-            }
-            // HHVars involved?
-            for (i = 0; i < m_HHVars.size(); i++) {
-                if (m_var[m_HHVars[i] ].SetMissing) {
-                    InvolvedVar[i] = true;
-		}
+		strncpy(PrevHH, CurrHH, nPos);
+		assert(HHSeqNr < (long) m_HHnRec.size());
+		assert(m_HHnRec[HHSeqNr] > 0);
+		Block.AddHousehold(HHSeqNr, m_HHnRec[HHSeqNr]);  // size, see ExploreFile
             }
+            Block.AddRecord(str, recnr);
 	}
     }
 
+    // the last records
+    if (!MakeBlockSafe(Block)) {
+        goto error;
+    }
+    WriteBlock(fd_out, Block, HHIdentOption, bPrintBHR);
+
     //TRACE("Total Unsafe: %d\n", m_nUnsafe);
 
 #ifdef SHOWUNSAFE
   fclose(fd_test);
 #endif // SHOWUNSAFE
 
+    if (fd_out != fd_safe) {
+        if (!RestoreRecordOrder(fd_out, fd_safe)) {
+            goto error;
+        }
+        fclose(fd_safe);
+    }
     fclose(fd_in);
     fclose(fd_out);
-    delete [] InvolvedVar;
     FireUpdateProgress(100);  // for progressbar in container
 
     return true;
@@ -3882,7 +6278,9 @@ bool CMuArgCtrl::MakeFileSafe(std::string FileName, bool WithPrior, bool WithEnt
 error:
     fclose(fd_in);
     fclose(fd_out);
-    delete [] InvolvedVar;
+    if (fd_out != fd_safe) {
+        fclose(fd_safe);
+    }
 
     return false;
 }
@@ -4087,10 +6485,8 @@ bool CMuArgCtrl::DoEntropy(long VarNr, double& Entropy)
 
     Entropy = 0;
 
-    for (i = 0; i < m_nUC; i++) {
-        if (m_UCList[i].nDim != 1) continue;
-        if (v != m_UCList[i].Varnr[0]) continue;
-
+    i = FindUCList(1, &v);
+    if (i >= 0) {
 	// that's the table with freqs, compute entropy now
 	if (m_tab[m_UCList[i].TabNr].nDim == m_UCList[i].nDim) {  // permanent table, can be 1-dimensional
             t = &(m_tab[m_UCList[i].TabNr]);
@@ -4114,10 +6510,8 @@ bool CMuArgCtrl::DoEntropy(long VarNr, double& Entropy)
 
 	// then the part with N
 	Entropy = log(N) / log(2) - Entropy / (N * log(2));
-	break;
     }
-
-    if (i == m_nUC) { // VarNr not found
+    else { // VarNr not found
 	return false;
     }
 
@@ -4127,17 +6521,17 @@ bool CMuArgCtrl::DoEntropy(long VarNr, double& Entropy)
 // fase = 0 first time
 // fase = 1 second time (only for HH's)
 
-bool CMuArgCtrl::MakeRecordSafe(char *record, int fase, int recnr, int nRecHH, long HHNum)
+bool CMuArgCtrl::MakeRecordSafe(char *record, int fase, int recnr, int nRecHH, long HHNum, CSafeRecordState &s)
 {
     int i, n;
     double score = 0, freqscore = 0, minscore = 0;
 
     // compute (recode)indices out of alfanumerical code for every categorical variable
-    if (!ComputeVarIndices(record) ) return false;
+    if (!ComputeVarIndices(record, s) ) return false;
 
     // compute unsafe combinations in m_UCList
     if (m_WithEntropy || m_WithPriority) {
-        n = ComputeRecordUC(HHNum);
+        n = ComputeRecordUC(HHNum, s);
     }
     else{
         n = 0;
@@ -4145,23 +6539,23 @@ bool CMuArgCtrl::MakeRecordSafe(char *record, int fase, int recnr, int nRecHH, l
 
     // set SetMissing on false and freq on zero for every variable
     for (i = 0; i < m_nvar; i++) {
-        m_var[i].SetMissing = false;
-	m_var[i].freq = 0;
+        s.SetMissing[i] = false;
+	s.freq[i] = 0;
     }
 
     // there are n unsafe combinations in this record
     if (n > 0) {
         if (fase == 0) { // in case of households fase can be > 0
-            m_nUnsafe++;
+            s.nUnsafe++;
 	}
 
 	// at first: a one dimensional table unsafe?
 	for (i = 0; i < m_nUC; i++) {
             CUCList *m = &(m_UCList[i]);
-            if (m->unsafe && m->nDim == 1) {
+            if (s.unsafe[i] && m->nDim == 1) {
         // set this variable on missing and sets all tables with this variable at safe
                 int iVar = m->Varnr[0];
-		SetVarMissing(iVar); // print
+		SetVarMissing(iVar, s); // print
 
 		if (m_WithPriority) {
                     score += m_var[iVar].Priority;  // waarom???
@@ -4176,7 +6570,7 @@ bool CMuArgCtrl::MakeRecordSafe(char *record, int fase, int recnr, int nRecHH, l
 	//CUIntArray UC;
         std::vector<unsigned int> UC;
 	for (i = 0; i < m_nUC; i++) {
-            if (m_UCList[i].unsafe) {
+            if (s.unsafe[i]) {
                 UC.push_back(i);
             }
 	}
@@ -4189,56 +6583,56 @@ bool CMuArgCtrl::MakeRecordSafe(char *record, int fase, int recnr, int nRecHH, l
 	//CUIntArray SetMissings1Dim;
         std::vector<unsigned int> SetMissings1Dim;
 	for (i = 0; i < m_nvar; i++) {
-            if (m_var[i].SetMissing) {
+            if (s.SetMissing[i]) {
                 SetMissings1Dim.push_back(i);
             }
 	}
 
 	//CUIntArray FreqMissings;
         std::vector<unsigned int> FreqMissings;
-	freqscore = SetFreqMissings(FreqMissings, nRecHH);    // function 1 to detect the vars to be set on Missing1
+	freqscore = SetFreqMissings(FreqMissings, nRecHH, s);    // function 1 to detect the vars to be set on Missing1
 
 	// reset UCs set bij SetFreqMissings
 	for (i = 0; i < UC.size(); i++) {
-            m_UCList[UC[i]].unsafe = true;
+            s.unsafe[UC[i]] = true;
 	}
 
     	// reset SetMissing and freq
 	for (i = 0; i < m_nvar; i++) {
-            m_var[i].SetMissing = false;
-            m_var[i].freq = 0;
+            s.SetMissing[i] = false;
+            s.freq[i] = 0;
 	}
 	// reset one dimensional vars
 	for (i = 0; i < SetMissings1Dim.size(); i++) {
-            SetVarMissing(SetMissings1Dim[i]);
+            SetVarMissing(SetMissings1Dim[i], s);
 	}
 
 	//CUIntArray MinMissings;
         std::vector<unsigned int> MinMissings;
-	minscore = SetMinMissings(MinMissings, nRecHH);  // function 2 to detect the vars to be set on Missing1
+	minscore = SetMinMissings(MinMissings, nRecHH, s);  // function 2 to detect the vars to be set on Missing1
 
 	// reset SetMissing and freq
 	for (i = 0; i < m_nvar; i++) {
-            m_var[i].SetMissing = false;
-            m_var[i].freq = 0;
+            s.SetMissing[i] = false;
+            s.freq[i] = 0;
 	}
 
 	if (freqscore - minscore > 0.1) {  // minscore better
             for (i = 0; i < MinMissings.size();i++) {
-                SetVarMissing(MinMissings[i]);//print + info welke
+                SetVarMissing(MinMissings[i], s);//print + info welke
             }
             score += minscore;
 	}
 	else {
             for (i = 0; i < FreqMissings.size();i++) {
-                SetVarMissing(FreqMissings[i]); //print + info welke
+                SetVarMissing(FreqMissings[i], s); //print + info welke
             }
             score += freqscore;
         }
 
         // reset SetMissings 1-dim           // AWTG 19-7-2001
 	for (i = 0; i < SetMissings1Dim.size(); i++) {
-            m_var[SetMissings1Dim[i] ].SetMissing = true;
+            s.SetMissing[SetMissings1Dim[i]] = true;
         }
 
 /*
@@ -4246,13 +6640,13 @@ bool CMuArgCtrl::MakeRecordSafe(char *record, int fase, int recnr, int nRecHH, l
     if (fabs(freqscore - minscore) >= 0.5) {
       // reset UCs
       for (i = 0; i < UC.GetSize(); i++) {
-        m_UCList[UC[i]].unsafe = true;
+        s.unsafe[UC[i]] = true;
       }
       ShowUCs(recnr);
       fprintf(fd_test, "Score: %.2f (freq=%.2f min=%.2f dif=%.2f)\n",
          score, freqscore, minscore, freqscore - minscore);
       for (i = 0; i < m_nvar; i++) {
-        if (m_var[i].SetMissing) {
+        if (s.SetMissing[i]) {
           fprintf(fd_test, "Op missing: %c\n", i +'A');
         }
       }
@@ -4281,8 +6675,28 @@ bool CMuArgCtrl::MakeRecordSafe(char *record, int fase, int recnr, int nRecHH, l
     return true;
 }
 
-// sets unsafe on true or false in m_UCList
-int CMuArgCtrl::ComputeRecordUC(long HHNum)
+// as ComputeVarIndices, the indices in s instead of in the variables
+bool CMuArgCtrl::ComputeVarIndices(char *record, CSafeRecordState &s)
+{
+    int v;
+    bool IsMissing;
+
+    for (v = 0; v < m_nvar; v++) {
+        CVariable *var = &(m_var[v]);
+	if (!var->IsCategorical) continue;
+	s.TableIndex[v] = ComputeTableIndex(record, var, v, IsMissing);
+	s.TableIsMissing[v] = IsMissing;
+	assert(s.TableIndex[v] >= 0);
+	if (s.TableIndex[v] < 0) {
+            return false;   // program error
+	}
+    }
+
+    return true;
+}
+
+// sets unsafe on true or false in s for the combinations of m_UCList
+int CMuArgCtrl::ComputeRecordUC(long HHNum, CSafeRecordState &s)
 {
     int i, j, n = 0, nDim, CellNr, HHSize;
     CTable t;   //Watch OUT
@@ -4295,7 +6709,8 @@ int CMuArgCtrl::ComputeRecordUC(long HHNum)
 	u = &(m_UCList[i]);
 	if (!u->biggestThreshold) continue;  // table irrelevant, there's another with bigger threshold
 	if (u->HasPram) continue;  // table irrelevant, contains prammed variables
-	u->unsafe = false;
+	s.unsafe[i] = false;
+	if (u->Pruned && !m_tab[u->TabNr].IsBIR) continue;  // table without unsafe cells
 	nDim = u->nDim;
 /*
 		if (t.Cell != 0) {
@@ -4323,9 +6738,9 @@ int CMuArgCtrl::ComputeRecordUC(long HHNum)
 	bool HasMissing = false;
 	for (j = 0; j < nDim; j++) {
             CellNr *= t.SizeDim[j];
-            CellNr += m_var[t.Varnr[j]].TableIndex;
-            DimNr[j] = m_var[t.Varnr[j]].TableIndex;  // remember for BIR
-            if (m_var[t.Varnr[j]].TableIsMissing) {
+            CellNr += s.TableIndex[t.Varnr[j]];
+            DimNr[j] = s.TableIndex[t.Varnr[j]];  // remember for BIR
+            if (s.TableIsMissing[t.Varnr[j]]) {
                 HasMissing = true;                      // remember for BIR
             }
 	}
@@ -4337,30 +6752,27 @@ int CMuArgCtrl::ComputeRecordUC(long HHNum)
             assert(t.GetCellNr(DimNr) == CellNr);  // DimNr correct?
             long freq = t.Cell[CellNr];
             double weight, v, logv;
-            bool temp;
             if (freq > 0) {
                 // returns false if all variables on Missing
-		if (AddMissing(t, DimNr, freq, weight, HasMissing) ) { // all corresponding Missing(s) are added
-                    temp = BaseIndividualRisk(freq, weight, &v);
-                    assert(temp);
+		if (GetCellBIR(t, DimNr, HasMissing, freq, weight, v) ) { // all corresponding Missing(s) are added
                     //Check the BIR first
                     if (v != 0) {
                         logv = log(v);
 			if (logv >= TBIRThres){ //t.BIRThreshold) {
-                            u->unsafe = true; // record unsafe for this combination, subtables too
+                            s.unsafe[i] = true; // record unsafe for this combination, subtables too
                             n++;
 			}
                         //And also for the BHR!
-			if (!u->unsafe ){
-                            if (m_lNumberOfHH > 0){
-                                HHSize = m_HH[HHNum].m_lNumberofMembers;
+			if (!s.unsafe[i] ){
+                            if (m_lNumberOfHH > 0 && HHNum >= 0){
+                                HHSize = m_HH.m_NumberofMembers[HHNum];
 				logBHR = 0;
-				if (m_HH[HHNum].m_dBHR[0]> 0){
-                                    logBHR = log(m_HH[HHNum].m_dBHR[0]);
+				if (m_HH.m_BHR[0][HHNum]> 0){
+                                    logBHR = log(m_HH.m_BHR[0][HHNum]);
 				}
 				logv = log(HHSize*v);
 				if (logv >= TBHRThres && logBHR >= TBHRThres ) { //t.BHRThreshold) {
-                                    u->unsafe = true; // record unsafe for this combination, subtables too
+                                    s.unsafe[i] = true; // record unsafe for this combination, subtables too
                                     n++;
 				}
                             }
@@ -4376,7 +6788,7 @@ int CMuArgCtrl::ComputeRecordUC(long HHNum)
 
 //			if (m_lNumberOfHH > 0)	{
 //				if (log((m_HH[HHNum].m_dBHR[BIRCounter])/m_HH[HHNum].m_lNumberofMembers) >= t.BHRThreshold)	{
-//					u->unsafe = true;
+//					s.unsafe[i] = true;
 //					n++;
 //				}
 //			}
@@ -4385,7 +6797,7 @@ int CMuArgCtrl::ComputeRecordUC(long HHNum)
             if (t.Cell[CellNr] > 0 && t.Cell[CellNr] <= t.Threshold && !HasMissing) {
                 //moeten we hier niet op missing letten? AHNL 2 dec 2004
 		//!HasMissing toegevoegd 24 jan 2005
-		u->unsafe = true;
+		s.unsafe[i] = true;
 		n++;
             }
 	}
@@ -4395,38 +6807,38 @@ int CMuArgCtrl::ComputeRecordUC(long HHNum)
 
 // sets flag to make variable missing
 // sets all tables with this variable at safe
-void CMuArgCtrl::SetVarMissing(int iVar)
+void CMuArgCtrl::SetVarMissing(int iVar, CSafeRecordState &s)
 {
     int i;
 
     assert(iVar >= 0 && iVar < m_nvar);
     assert(m_var[iVar].IsCategorical);
 
-    m_var[iVar].SetMissing = true;
+    s.SetMissing[iVar] = true;
     if (m_var[iVar].RelatedTo >= 0) {
 //		SetVarMissing(m_var[iVar].RelatedTo); Gevaarlijk
         i = m_var[iVar].RelatedTo;
-	m_var[i].SetMissing = true;
+	s.SetMissing[i] = true;
     }
 
     int d;
     // all tables with this variable are safe now
     for (i = 0; i < m_nUC; i++){
-        if (m_UCList[i].unsafe){
+        if (s.unsafe[i]){
             for (d = 0; d < m_UCList[i].nDim; d++) {
                 if (m_UCList[i].Varnr[d] == iVar) {
                     break;
 		}
             }
             if (d < m_UCList[i].nDim) {  // variable is in the table
-                m_UCList[i].unsafe = false;
+                s.unsafe[i] = false;
             }
 	}
     }
 }
 
 // sets missings
-double CMuArgCtrl::SetFreqMissings(std::vector<unsigned int> &FreqMissing, int nRecHH)
+double CMuArgCtrl::SetFreqMissings(std::vector<unsigned int> &FreqMissing, int nRecHH, CSafeRecordState &s)
 {
     int i, d, nUnsafeTab, ni = -1;
     double score = 0.0;
@@ -4436,14 +6848,14 @@ double CMuArgCtrl::SetFreqMissings(std::vector<unsigned int> &FreqMissing, int n
 
 	// zero freq
 	for (i = 0; i < m_nvar; i++) {
-            m_var[i].freq = 0;
+            s.freq[i] = 0;
 	}
 	for (i = 0; i < m_nUC; i++) {
-            if (m_UCList[i].unsafe) {
+            if (s.unsafe[i]) {
                 nUnsafeTab++;
 		// count freq variable
 		for (d = 0; d < m_UCList[i].nDim; d++) {
-                    m_var[m_UCList[i].Varnr[d] ].freq++;
+                    s.freq[m_UCList[i].Varnr[d]]++;
 		}
             }
 	}
@@ -4461,14 +6873,14 @@ double CMuArgCtrl::SetFreqMissings(std::vector<unsigned int> &FreqMissing, int n
 	// bij meerdere kandidaten die met kleinste prio/entro
 	for (i = 0; i < m_nvar; i++) {
             if (!m_var[i].IsCategorical) continue;
-            if (m_var[i].freq > maxfreq) {
-                maxfreq = m_var[i].freq;
+            if (s.freq[i] > maxfreq) {
+                maxfreq = s.freq[i];
 		maxprio = m_var[i].Priority;
 		maxentrop = m_var[i].Entropy;
 		ni = i;
             }
             else {
-                if (m_var[i].freq == maxfreq) {
+                if (s.freq[i] == maxfreq) {
                     if (m_WithPriority) {
                         if (m_var[i].Priority * GetHHSizeFactor(i, nRecHH) < maxprio) {
                             maxprio = m_var[i].Priority * GetHHSizeFactor(i, nRecHH);
@@ -4485,7 +6897,7 @@ double CMuArgCtrl::SetFreqMissings(std::vector<unsigned int> &FreqMissing, int n
             }
 	}
 	assert(ni >= 0 && ni < m_nvar);
-	SetVarMissing(ni);
+	SetVarMissing(ni, s);
 	FreqMissing.push_back(ni);
 	if (m_WithPriority) {
             score += m_var[ni].Priority * GetHHSizeFactor(ni, nRecHH);
@@ -4499,7 +6911,7 @@ double CMuArgCtrl::SetFreqMissings(std::vector<unsigned int> &FreqMissing, int n
 }
 
 // sets missings, second method
-double CMuArgCtrl::SetMinMissings(std::vector<unsigned int> &MinMissing, int nRecHH)
+double CMuArgCtrl::SetMinMissings(std::vector<unsigned int> &MinMissing, int nRecHH, CSafeRecordState &s)
 {
     int i, j, nUnsafeTab, ni, ndim, iVar;
     double score = 0.0;
@@ -4510,7 +6922,7 @@ double CMuArgCtrl::SetMinMissings(std::vector<unsigned int> &MinMissing, int nRe
         nUnsafeTab = 0;
 	for (i = 0; i < m_nUC; i++) {
             CUCList *m = &(m_UCList[i]);
-            if (!m->unsafe) continue;
+            if (!s.unsafe[i]) continue;
             nUnsafeTab++;
             if (m->nDim == ndim) {
             // bereken gunstigste var
@@ -4534,7 +6946,7 @@ double CMuArgCtrl::SetMinMissings(std::vector<unsigned int> &MinMissing, int nRe
 		// set this variable on missing and
 		// sets all tables with this variable at safe
 
-		SetVarMissing(ni);
+		SetVarMissing(ni, s);
 		MinMissing.push_back(ni);
 		if (m_WithPriority) {
                     score += m_var[ni].Priority * GetHHSizeFactor(ni, nRecHH); // !! x huishoudgrootte
@@ -4924,7 +7336,7 @@ bool CMuArgCtrl::WriteRecord(FILE *fd_out, char *record, long HHIdentOption, lon
             for (i=0; i<m_lNumBIRs; i++){
                 if (HHNum < m_lNumberOfHH){
 //                  fprintf(fd_out,",BHR = %14.12f",m_HH[HHNum].m_dBHR[i]);
-                    fprintf(fd_out," %14.12f",m_HH[HHNum].m_dBHR[i]);
+                    fprintf(fd_out," %14.12f",m_HH.m_BHR[i][HHNum]);
 //                  fprintf(fd_out," %14.12f",m_HH[HHNum].m_dBHR[i]/m_HH[HHNum].m_lNumberofMembers );
 		}
             }
@@ -4994,92 +7406,116 @@ int CMuArgCtrl::GetRandomInteger()
     // returns 0 - 2147483647
 }
 
-int CMuArgCtrl::ComputeRecHH(FILE *fd, int bpos, int npos)
+// Look at this part.
+// I think this is where the household is made safe.
+// makes the records of Block safe, the result is kept in Block for WriteBlock. The
+// households are independent, so they are divided over threads with their own state
+bool CMuArgCtrl::MakeBlockSafe(CSafeFileBlock &Block)
 {
-    char str[MAXRECORDLENGTH];
-    char FirstHH[MAXCODEWIDTH];      // first household ident
-    int res, nrec;
+    long h, nError = 0, nUnsafe = 0;
+
+    Block.TableIndex.resize(Block.nRec * m_nvar);
+    Block.SetMissing.resize(Block.nRec * m_nvar);
 
-    res = ReadMicroRecord(fd, str); // first record of household
-    switch (res) {
-	case INFILE_ERROR:
-	case INFILE_EOF:
-            return 0;
+#ifdef _OPENMP
+#pragma omp parallel if (Block.nRec * m_nUC >= PARALLELMINCELLS)
+#endif
+    {
+        char str[MAXRECORDLENGTH];
+        CSafeRecordState s;
+        s.Prepare(m_nvar, m_nUC);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 16) reduction(+:nError)
+#endif
+        for (h = 0; h < Block.nHH; h++) {
+            long r = Block.HHFirst[h];
+            if (Block.HHNum[h] >= 0) {
+                if (!DoCompleteHH(Block, h, s)) {
+                    nError++;
+                }
+                continue;
+            }
+            strcpy(str, Block.Record[r].c_str());
+            if (!MakeRecordSafe(str, 0, Block.RecNr[r], 1, -1, s)) {
+                nError++;
+                continue;
+            }
+            Block.Keep(r, s);
+        }
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+        nUnsafe += s.nUnsafe;
     }
+    m_nUnsafe += nUnsafe;
+
+    return nError == 0;
+}
 
-    strncpy(FirstHH, (char *) &str[bpos], npos);
-    nrec = 1;
+// a household of Block: first every record is made safe on its own, then again with the
+// household variables set on missing in one of the records set on missing in all records
+bool CMuArgCtrl::DoCompleteHH(CSafeFileBlock &Block, long h, CSafeRecordState &s)
+{
+    char str[MAXRECORDLENGTH];
+    long r, HHNum = Block.HHNum[h];
+    int i, nRecHH = Block.HHSize[h];
+    std::vector<bool> InvolvedVar(m_HHVars.size(), false);
 
-    while (res = ReadMicroRecord(fd, str), res == INFILE_OKE) {
-        if (strncmp(FirstHH, (char *) &str[bpos], npos) != 0) break;
-        nrec++;
+    for (r = Block.HHFirst[h]; r < Block.HHEnd(h); r++) {
+        strcpy(str, Block.Record[r].c_str());
+        if (!MakeRecordSafe(str, 0, Block.RecNr[r], nRecHH, HHNum, s)) {
+            return false;
+        }
+        // HHVars involved?
+        for (i = 0; i < (int) m_HHVars.size(); i++) {
+            if (s.SetMissing[m_HHVars[i]]) {
+                InvolvedVar[i] = true;
+            }
+        }
     }
 
-    return nrec;
+    for (r = Block.HHFirst[h]; r < Block.HHEnd(h); r++) {
+        strcpy(str, Block.Record[r].c_str());
+        MakeRecordSafe(str, 1, Block.RecNr[r], nRecHH, HHNum, s); // !! parameter nRecHH = huishoudgrootte
+        for (i = 0; i < (int) m_HHVars.size(); i++) {
+            if (InvolvedVar[i]) {
+                s.SetMissing[m_HHVars[i]] = true;
+            }
+        }
+        Block.Keep(r, s);
+    }
+    return true;
 }
 
-// Look at this part.
-// I think this is where the household is made safe.
-bool CMuArgCtrl::DoCompleteHH(FILE *fd, FILE *fd_out, long StartPos, int n_rec,	int *InvolvedVar, int recnr, long HHIdentOption, long HHNum, bool PrintBIR)
+// writes the records of Block made safe by MakeBlockSafe, in the order of the file
+void CMuArgCtrl::WriteBlock(FILE *fd_out, CSafeFileBlock &Block, long HHIdentOption, bool PrintBIR)
 {
-    int i, j, ReadCode;
-    //CString cstr;
     char str[MAXRECORDLENGTH];
-    bool WithBHR = false;
     char orgstr[MAXRECORDLENGTH];
+    long h, r;
+    int v;
 
-    /*
-#ifdef _DEBUGG
-  #define SHOWHH
-#endif  // _DEBUG
-
-#ifdef SHOWHH
-  char code[MAXCODEWIDTH];
-  int n = 0, testvar[10];
-#endif // SHOWHH
-*/
-
-    fseek(fd, StartPos, SEEK_SET);
-    
-    for (i = 0; i < n_rec; i++) {
-        if (i == 0){
-            WithBHR = true;
-	}
-	else{
-            WithBHR = false;
-	}
-	if (ReadCode = ReadMicroRecord(fd, str), ReadCode != INFILE_OKE) {
-            return false;
-	}
-	strcpy((char *)orgstr,(char *)str);
-	MakeRecordSafe(str, 1, recnr, n_rec, HHNum); // !! parameter n_rec = huishoudgrootte
-	for (j = 0; j < m_HHVars.size(); j++) {
-            if (InvolvedVar[j]) {
-                m_var[m_HHVars[j]].SetMissing = true;
-		/*
-#ifdef SHOWHH
-        if (i == 0) {
-          testvar[n++] = m_HHVars[j] + 1;
+    for (h = 0; h < Block.nHH; h++) {
+        if (Block.HHNum[h] >= 0) {
+            m_HHSeqNr = Block.HHNum[h] + 1;  // written by WriteRecord
         }
-#endif // SHOWHH*/
+        for (r = Block.HHFirst[h]; r < Block.HHEnd(h); r++) {
+            for (v = 0; v < m_nvar; v++) {
+                if (m_var[v].IsCategorical) {
+                    m_var[v].TableIndex = Block.TableIndex[r * m_nvar + v];
+                }
+                m_var[v].SetMissing = Block.SetMissing[r * m_nvar + v] != 0;
             }
-	}
-	WriteRecord(fd_out, str, HHIdentOption, i, WithBHR, HHNum, PrintBIR, orgstr);
+            strcpy((char *)str, Block.Record[r].c_str());
+            strcpy((char *)orgstr,(char *)str);
+            if (Block.HHNum[h] < 0) {
+                WriteRecord(fd_out, str, HHIdentOption, Block.RecNr[r], false, 0, PrintBIR, orgstr);
+            }
+            else {
+                WriteRecord(fd_out, str, HHIdentOption, r - Block.HHFirst[h], r == Block.HHFirst[h], Block.HHNum[h], PrintBIR, orgstr);
+            }
+        }
     }
-/*
-#ifdef SHOWHH
-  strncpy(code, (char *) (&str[m_var[m_HHIdentVar].bPos]), m_var[m_HHIdentVar].nPos);
-  code[m_var[m_HHIdentVar].nPos] = 0;
-  TRACE("Read %d records with HHCode = %s\n", n_rec, code);
-  for (i = 0; i < n; i++) {
-    char s[10];
-    sprintf(s, "%d ", testvar[i]);
-    cstr += s;
-  }
-  TRACE("Vars %s\n", (LPCTSTR) cstr);
-#endif // SHOWHH
-*/
-    return true;
 }
 
 
@@ -5130,60 +7566,193 @@ bool CMuArgCtrl::NumberOfHH(char *str, long &HHNumbers)
     return true;
 }
 
-
-bool CMuArgCtrl::IsNewHH(char *str)
+// copies the data file fd to m_GroupFileName with the records sorted on HHIdent, records
+// of a household in file order, see SetHouseholdGrouping. Grouped is false if the households
+// were contiguous already, then the copy is removed
+bool CMuArgCtrl::GroupHouseholdFile(FILE *fd, long *ErrorCode, long *LineNumber, bool *Grouped)
 {
-    int i, bp, ap;
+    char str[MAXRECORDLENGTH];
     char code[MAXCODEWIDTH];
-    CVariable *var;
-    std::string tempcode;
-    std::string HHcode;
-    bool IsFirstHH = false;
-    for (i= 0; i<m_nvar; i++) {
-	var = &(m_var[i]);
-	if (var->IsHHIdent) {
-            if(m_InFileIsFixedFormat) {
-		bp = var->bPos;         // startposition
-		ap = var->nPos;         // number of positions
-		strncpy(code, (const char *)&str[bp], ap); // get code from record
-		code[ap] = 0;
-		HHcode = code;
-            }
-            else {
-		ap = var->nPos;         // number of positions
-		if (ReadVariableFreeFormat(str,i,&(tempcode))) {
-					/*strcpy(code,(const char*)tempcode);
-					code[ap] = 0;*/
-                    HHcode=tempcode;
-		}
-            }
-	}
-	else {
-            continue;
-	}
+    std::string HHcode, PrevHHcode, FirstLine;
+    long recnr = 0, nChange = 0, nHH = 0;
+    int res;
+    CVariable *var = &(m_var[m_HHIdentVar]);
+    CRecordSort Sort(m_InFileIsFixedFormat ? var->nPos : MAXCODEWIDTH - 1);
+    CRecordKey k;
+    FILE *fd_out;
+
+    *Grouped = false;
+    rewind(fd);
+    if ((!m_InFileIsFixedFormat)&&(m_IgnoreFirstLine)) {
+        ReadMicroRecord(fd, str);
+        FirstLine = str;
+    }
+    while (1) {
+        long RecPos = ftell(fd);
+        res = ReadMicroRecord(fd, str);
+        if (res == INFILE_EOF) {
+            break;
+        }
+        if (res == INFILE_ERROR) {
+            *ErrorCode = WRONGLENGTH;
+            *LineNumber = recnr + 1;
+            return false;
+        }
+        if (m_InFileIsFixedFormat) {
+            strncpy(code, (const char *)&str[var->bPos], var->nPos);
+            code[var->nPos] = 0;
+            HHcode = code;
+        }
+        else if (!ReadVariableFreeFormat(str, m_HHIdentVar, &HHcode)) {
+            HHcode = "";  // as NumberOfHH: the record is rejected by ExploreFile later
+        }
+        if (recnr == 0 || HHcode != PrevHHcode) {
+            nChange++;
+            PrevHHcode = HHcode;
+        }
+        if (!Sort.Add(HHcode, recnr, RecPos)) {
+            *ErrorCode = CANTOPENFILE;
+            return false;
+        }
+        recnr++;
+    }
+    if (!Sort.Sort()) {
+        *ErrorCode = CANTOPENFILE;
+        return false;
+    }
+
+    fd_out = fopen(m_GroupFileName.c_str(), "w");
+    if (fd_out == 0) {
+        *ErrorCode = CANTOPENFILE;
+        return false;
+    }
+    if (m_KeepRecordOrder) {
+        m_GroupSeqFile = tmpfile();
+        if (m_GroupSeqFile == 0) {
+            fclose(fd_out);
+            *ErrorCode = CANTOPENFILE;
+            return false;
+        }
+    }
+    if ((!m_InFileIsFixedFormat)&&(m_IgnoreFirstLine)) {
+        fprintf(fd_out, "%s\n", FirstLine.c_str());
+    }
+    while ((res = Sort.Next(k)) == INFILE_OKE) {
+        if (nHH == 0 || k.Key != PrevHHcode) {
+            nHH++;
+            PrevHHcode = k.Key;
+        }
+        if (fseek(fd, k.Pos, SEEK_SET) != 0 || ReadMicroRecord(fd, str) != INFILE_OKE) {
+            res = INFILE_ERROR;
+            break;
+        }
+        fprintf(fd_out, "%s\n", str);
+        if (m_GroupSeqFile != 0 && fwrite(&k.Seq, sizeof(long), 1, m_GroupSeqFile) != 1) {
+            res = INFILE_ERROR;
+            break;
+        }
+    }
+    if (fflush(fd_out) != 0 || ferror(fd_out) || (m_GroupSeqFile != 0 && fflush(m_GroupSeqFile) != 0)) {
+        res = INFILE_ERROR;
+    }
+    fclose(fd_out);
+    rewind(fd);
+    if (res == INFILE_ERROR) {
+        ClearHouseholdGrouping();
+        remove(m_GroupFileName.c_str());
+        *ErrorCode = CANTOPENFILE;
+        return false;
+    }
+
+    if (nHH == nChange) {  // every household contiguous: the data file is used as it is
+        remove(m_GroupFileName.c_str());
+        ClearHouseholdGrouping();
+        return true;
+    }
+    m_FileGrouped = true;
+    *Grouped = true;
+    return true;
+}
+
+// copies fd_grouped, a safe file written from the grouped copy of the data file, to fd_out
+// with the records in the order of the data file. false on a read or write error, or
+// if the records do not match the record numbers of the grouped copy
+bool CMuArgCtrl::RestoreRecordOrder(FILE *fd_grouped, FILE *fd_out)
+{
+    std::string Line;
+    long Seq;
+    int res;
+    CRecordSort Sort(0);
+    CRecordKey k;
+
+    rewind(fd_grouped);
+    rewind(m_GroupSeqFile);
+    if ((!m_InFileIsFixedFormat)&&(m_IgnoreFirstLine)&&(!m_FirstLine.empty())) {
+        if (ReadWholeLine(fd_grouped, Line) != INFILE_OKE) {
+            return false;
+        }
+        fputs(Line.c_str(), fd_out);  // the first line stays first
+    }
+    while (1) {
+        long RecPos = ftell(fd_grouped);
+        res = ReadWholeLine(fd_grouped, Line);
+        if (res == INFILE_EOF) {
+            break;
+        }
+        if (res == INFILE_ERROR || fread(&Seq, sizeof(long), 1, m_GroupSeqFile) != 1 || !Sort.Add("", Seq, RecPos)) {
+            return false;
+        }
+    }
+    if (fread(&Seq, sizeof(long), 1, m_GroupSeqFile) != 0 || !Sort.Sort()) {
+        return false;  // fewer records than in the grouped copy
+    }
+    while ((res = Sort.Next(k)) == INFILE_OKE) {
+        if (fseek(fd_grouped, k.Pos, SEEK_SET) != 0 || ReadWholeLine(fd_grouped, Line) != INFILE_OKE) {
+            return false;
+        }
+        fputs(Line.c_str(), fd_out);
     }
+    return res == INFILE_EOF && ferror(fd_out) == 0;
+}
 
-    CurrentHHName = HHcode;
-    if (LastHHName == "") {
-        LastHHName = CurrentHHName;
-	return false;
+// reads a line of any length with its end of line: INFILE_OKE, INFILE_EOF or INFILE_ERROR
+int CMuArgCtrl::ReadWholeLine(FILE *fd, std::string &Line)
+{
+    char str[MAXRECORDLENGTH];
+
+    Line.clear();
+    while (fgets(str, MAXRECORDLENGTH, fd) != 0) {
+        Line += str;
+        if (Line[Line.size() - 1] == '\n') {
+            return INFILE_OKE;
+        }
     }
-    if (LastHHName == CurrentHHName) {
-        return false;
+    if (ferror(fd)) {
+        return INFILE_ERROR;
     }
-    else {
-        LastHHName = CurrentHHName;
-	return true;
+    return Line.empty() ? INFILE_EOF : INFILE_OKE;  // the last line may have no end of line
+}
+
+// forgets the grouped copy of the data file and removes it
+void CMuArgCtrl::ClearHouseholdGrouping()
+{
+    if (m_FileGrouped) {
+        remove(m_GroupFileName.c_str());
+        m_FileGrouped = false;
+    }
+    if (m_GroupSeqFile != 0) {
+        fclose(m_GroupSeqFile);
+        m_GroupSeqFile = 0;
     }
 }
 
+
 bool CMuArgCtrl::CalculateBaseHouseholdRisk(long *ErrorCode)
 {
     FILE *fd_in;
     long i,j;
     char str[MAXRECORDLENGTH];
     double *tempBIRarray;
-    tempBIRarray = new double [m_lNumBIRs];
     if (m_lNumberOfHH == 0){
         *ErrorCode = NOHOUSEHOLDS;
 	return false;
@@ -5194,6 +7763,12 @@ bool CMuArgCtrl::CalculateBaseHouseholdRisk(long *ErrorCode)
 	return false;
     }
 
+    m_BHRIndex.clear();  // BHRs change
+    if (m_RecCodesValid) {
+        // the codes of all records are kept by ComputeTables, no need to read the file
+        return CalculateHouseholdRiskFromCodes();
+    }
+
     if (m_fname[0] == 0){
 	*ErrorCode = NODATAFILE;
 	return false;
@@ -5203,6 +7778,7 @@ bool CMuArgCtrl::CalculateBaseHouseholdRisk(long *ErrorCode)
     if (fd_in == 0) {
 	return false;
     }
+    tempBIRarray = new double [m_lNumBIRs];
 
     long recnr = 0;
     long res;
@@ -5212,10 +7788,10 @@ bool CMuArgCtrl::CalculateBaseHouseholdRisk(long *ErrorCode)
 	res = ReadMicroRecord(fd_in, str);
     } // AHNL 30 maart 2005 Eerste record weglezen bij SAS file
 
+    // First allocate space for BIRs of all members
+    m_HH.PrepareHouseholdBIR();
     for (i=0; i<m_lNumberOfHH; i++) {
-	// First allocate space for BIRs in HH
-	m_HH[i].PrepareHouseholdBIR(m_lNumBIRs);
-	for (j=0; j<m_HH[i].m_lNumberofMembers; j++) {
+	for (j=0; j<m_HH.m_NumberofMembers[i]; j++) {
             res = ReadMicroRecord(fd_in, str);
             if (++recnr % FIREPROGRESS == 0) {
 		FireUpdateProgress((int)(ftell(fd_in) *100.0/m_fSize));
@@ -5225,6 +7801,7 @@ bool CMuArgCtrl::CalculateBaseHouseholdRisk(long *ErrorCode)
                     // goto error;
                     delete[]tempBIRarray;
                     fclose(fd_in);
+                    m_HH.ClearHouseholdBIR();
                     return false;
                     break;
                 case INFILE_EOF: // should not happen
@@ -5239,76 +7816,144 @@ bool CMuArgCtrl::CalculateBaseHouseholdRisk(long *ErrorCode)
                     if (!FindBIRForRec(str,tempBIRarray)) {
 			return false;
                     }
-                    m_HH[i].SaveBIR(tempBIRarray,m_lNumBIRs,j);
+                    m_HH.SaveBIR(i, j, tempBIRarray);
 //				}
 
             } // end case
         } // end for j
 
 	// maybe check for infile file endings before it should
-	if (j < m_HH[i].m_lNumberofMembers-1){
+	if (j < m_HH.m_NumberofMembers[i]-1){
             delete[] tempBIRarray;
             fclose(fd_in);
+            m_HH.ClearHouseholdBIR();
             return false;
 	}
-	if (!m_HH[i].CalculateBHR(m_lNumBIRs)){
+	if (!m_HH.CalculateBHR(i)){
 
 	}
     }// end for i
 
+    m_HH.ClearHouseholdBIR();
     delete[] tempBIRarray;
     fclose(fd_in);
     return true;
 }
 
+// the BHRs of all households from the record codes kept by ComputeTables, the
+// households are independent and computed in parallel when built with OpenMP
+// (-fopenmp, see nbproject) and there are PARALLELMINCELLS records or more
+bool CMuArgCtrl::CalculateHouseholdRiskFromCodes()
+{
+    long i, nHH = m_HH.m_nHH, nError = 0;
+
+    // the cell risks are computed here once, the threads only read them
+    for (i = 0; i < m_ntab; i++) {
+        CTable &t = m_tab[i].HasRecode ? m_tab[i + m_ntab] : m_tab[i];
+        if (t.IsBIR) {
+            FindBIRCells(t);
+        }
+    }
+
+    m_HH.PrepareHouseholdBIR();
+#ifdef _OPENMP
+#pragma omp parallel if (m_HH.m_MemberStart[nHH] >= PARALLELMINCELLS)
+#endif
+    {
+        std::vector<int> VarIndex(m_nvar, 0);
+        std::vector<bool> VarMissing(m_nvar, false);
+        std::vector<double> BIRarray(m_lNumBIRs, 0);
+#ifdef _OPENMP
+#pragma omp for reduction(+:nError)
+#endif
+        for (i = 0; i < nHH; i++) {
+            for (long j = 0; j < m_HH.m_NumberofMembers[i]; j++) {
+                if (!FindBIRForRecNr(m_HH.m_MemberStart[i] + j, VarIndex, VarMissing, &BIRarray[0])) {
+                    nError++;
+                    continue;
+                }
+                m_HH.SaveBIR(i, j, &BIRarray[0]);
+            }
+            m_HH.CalculateBHR(i);
+        }
+    }
+    m_HH.ClearHouseholdBIR();
+
+    return nError == 0;
+}
+
 bool CMuArgCtrl::FindBIRForRec(char *record, double *BIRarray)
 {
-    long i,j, freq, bircounter = 0;;
-    CTable t;
-    double weight,v;
-    long CellNr;
-    bool temp;
-    int DimNr[MAXDIM];
+    int v;
+
     if (!ComputeVarIndices(record) ) return false;
-    for (i=0; i<m_ntab; i++) {
-	t = m_tab[i];
-	if (t.HasRecode){
-            t = m_tab[i+m_ntab];
-	}
-	if (t.IsBIR){
-            CellNr = 0;
-            bool  HasMissing = false;
-            for (j =0; j<t.nDim; j++){
-		CellNr *= t.SizeDim[j];
-		CellNr += m_var[t.Varnr[j]].TableIndex;
-		DimNr[j] = m_var[t.Varnr[j]].TableIndex;
-
-		if (m_var[t.Varnr[j]].TableIsMissing) {
-                    HasMissing = true;
-		}
-            }
+    std::vector<int> VarIndex(m_nvar, 0);
+    std::vector<bool> VarMissing(m_nvar, false);
+    for (v = 0; v < m_nvar; v++) {
+        VarIndex[v] = m_var[v].TableIndex;
+        VarMissing[v] = m_var[v].TableIsMissing;
+    }
+    ComputeRecBIR(VarIndex, VarMissing, BIRarray);
 
-            assert(t.GetCellNr(DimNr) == CellNr);
-            freq = t.Cell[CellNr];
-            if (freq >0 ) {
-		if (AddMissing(t,DimNr,freq,weight, HasMissing)) {
-                    temp = BaseIndividualRisk(freq,weight,&v);
-                    assert(temp);
-                    // Not sure if v has to be added to the array or log v
-                    BIRarray[bircounter] = v; // log v
-                    bircounter++;
-		}
-            }
-            else {
-                BIRarray[bircounter] = 0;
-		bircounter++;
+    return true;
+}
+
+// as FindBIRForRec for record RecNr (0, 1, ...), with the codes kept by ComputeTables;
+// VarIndex and VarMissing are room of m_nvar, so threads can use their own
+bool CMuArgCtrl::FindBIRForRecNr(long RecNr, std::vector<int>& VarIndex, std::vector<bool>& VarMissing, double *BIRarray)
+{
+    long k = RecNr * m_RecVars.size();
+
+    for (int i = 0; i < (int) m_RecVars.size(); i++, k++) {
+        CVariable &var = m_var[m_RecVars[i]];
+        int Index = m_RecCodeIndex[k];
+        // in case of a recode, take the recode index (see CVariable::SetTableIndex)
+        if (var.HasRecode) {
+            Index = var.Recode.DestCode[Index];
+            assert(Index >= 0);
+            if (Index < 0) {
+                return false;   // program error
             }
-	}
+        }
+        VarIndex[m_RecVars[i]] = Index;
+        VarMissing[m_RecVars[i]] = m_RecCodeMissing[k];
     }
+    ComputeRecBIR(VarIndex, VarMissing, BIRarray);
 
     return true;
 }
 
+// the BIR of a record in every BIR table, from the code index and missing of each variable;
+// 0 for a record with all variables of the table on missing
+void CMuArgCtrl::ComputeRecBIR(const std::vector<int>& VarIndex, const std::vector<bool>& VarMissing, double *BIRarray)
+{
+    long i, j, freq, bircounter = 0;
+    double weight, v;
+    int DimNr[MAXDIM];
+
+    for (i = 0; i < m_ntab; i++) {
+        CTable &t = m_tab[i].HasRecode ? m_tab[i + m_ntab] : m_tab[i];
+        if (!t.IsBIR) continue;
+
+        bool HasMissing = false;
+        for (j = 0; j < t.nDim; j++) {
+            DimNr[j] = VarIndex[t.Varnr[j]];
+            if (VarMissing[t.Varnr[j]]) {
+                HasMissing = true;
+            }
+        }
+        v = 0;
+        freq = t.Cell[t.GetCellNr(DimNr)];
+        if (freq > 0) {
+            if (!GetCellBIR(t, DimNr, HasMissing, freq, weight, v)) {
+                v = 0;
+            }
+        }
+        BIRarray[bircounter] = v;
+        bircounter++;
+    }
+}
+
 
 void CMuArgCtrl::ComputeTableBIR(CTable &t, int& BIRFreq, double& BIRWeight, double& BIR)
 { 
@@ -5325,12 +7970,9 @@ void CMuArgCtrl::ComputeTableBIR(CTable &t, int& BIRFreq, double& BIRWeight, dou
 
     long freq = t.Cell[t.GetCellNr(DimNr)];
     double weight, v;
-    bool temp;
     if (freq > 0) {
 	// returns false if all variables on Missing
-	if (AddMissing(t, DimNr, freq, weight, HasMissing) ) { // all corresponding Missing(s) are added
-            temp = BaseIndividualRisk(freq, weight, &v);
-            assert(temp);
+	if (GetCellBIR(t, DimNr, HasMissing, freq, weight, v) ) { // all corresponding Missing(s) are added
             BIRFreq = freq;
             BIRWeight = weight;
             BIR = v;
@@ -5346,8 +7988,6 @@ void CMuArgCtrl::ComputeTableBIR(CTable &t, int& BIRFreq, double& BIRWeight, dou
 bool CMuArgCtrl::GetBHRHistogramData(long TableIndex, long nClasses, double *ClassLeftValue, long *HHFrequency, long *RecFrequency)
 {
     long i, k,index, BIRCounter=0;
-    double *temparray;
-    long ci;
 
     index = TableIndex -1;
 
@@ -5373,16 +8013,7 @@ bool CMuArgCtrl::GetBHRHistogramData(long TableIndex, long nClasses, double *Cla
 	}
     }
 
-    temparray = new double [m_lNumberOfHH];
-    for (i=0; i<m_lNumberOfHH; i++){
-	temparray[i] =  m_HH[i].m_dBHR[BIRCounter];
-    }
-
-    QuickSortDoubleArray(temparray,0,m_lNumberOfHH-1);
-
-    for (i=0; i<m_lNumberOfHH; i++){
-    	temparray[i] =  log(temparray[i]);
-    }
+    CBHRIndex &h = FindBHRIndex(BIRCounter);
 
     CTable *t = &(m_tab[index]);
     //ANCO:  Neem indien nodig  de recoded tabel!!!!
@@ -5390,8 +8021,8 @@ bool CMuArgCtrl::GetBHRHistogramData(long TableIndex, long nClasses, double *Cla
 	t = &(m_tab[m_ntab + index]); // take the recoded one
     }
 
-    t->BHRMaxValue = temparray[m_lNumberOfHH-1];
-    t->BHRMinValue = temparray[0];
+    t->BHRMaxValue = h.SortLogBHR[m_lNumberOfHH-1];
+    t->BHRMinValue = h.SortLogBHR[0];
     t->BHRnClasses = nClasses;
     // compute class width
     t->BHRClassWidth= (t->BHRMaxValue - t->BHRMinValue) / nClasses;
@@ -5401,85 +8032,22 @@ bool CMuArgCtrl::GetBHRHistogramData(long TableIndex, long nClasses, double *Cla
 	ClassLeftValue[k] = t->BHRMinValue + k * t->BHRClassWidth;
     }
 
+    std::vector<long> Start;
+    HistogramClassStart(h.SortLogBHR, t->BHRMinValue, t->BHRClassWidth, nClasses, Start);
     for (k=0; k< nClasses; k++){
-	HHFrequency[k] = 0;
-	RecFrequency[k] = 0;
-    }
-
-/*	for (k=0;  k< nClasses; k++)	{
-		for (i=0; i<m_lNumberOfHH; i++)	{
-		//	if ((log(m_HH[i].m_dBHR[BIRCounter]) >= ClassLeftValue[k])
-					//&& (log(m_HH[i].m_dBHR[BIRCounter]) < ClassLeftValue[k+1]))
-			if ((log(m_HH[i].m_dBHR[BIRCounter]) >= ClassLeftValue[k])
-					&& (log(m_HH[i].m_dBHR[BIRCounter]) < ClassLeftValue[k+1]))
-			{
-				HHFrequency[k]= HHFrequency[k]+1;
-				RecFrequency[k] = RecFrequency[k] + m_HH[i].m_lNumberofMembers;
-			}
-		}
-	}*/
-
-    for (i=0; i<m_lNumberOfHH; i++)	{
-	ci = (int) ((log(m_HH[i].m_dBHR[BIRCounter]) - t->BHRMinValue) / t->BHRClassWidth);
-	if (ci == t->BHRnClasses) ci--;  // can happen in rare cases, due to rounding
-        //assert(ci >= 0 && ci < t.BIRnClasses);
-        HHFrequency[ci] = HHFrequency[ci] +1;
-        RecFrequency[ci] = RecFrequency[ci] + m_HH[i].m_lNumberofMembers;
+	HHFrequency[k] = Start[k + 1] - Start[k];
+	RecFrequency[k] = h.CumRec[Start[k + 1]] - h.CumRec[Start[k]];
     }
 
-    delete [] temparray;
     return true;
 }
 
 
-void CMuArgCtrl::QuickSortDoubleArray(double * d, int first, int last)
-{ 
-    int i, j;
-    double mid, temp;
-    assert(first >= 0 && last >= first);
-
-    do{
-        i = first;
-        j = last;
-        mid = (d[(i + j) / 2]);
-        do {
-            while (d[i] < mid) i++;
-            while (d[j] > mid) j--;
-            if (i < j) {
-                temp = d[i];
-                d[i] = d[j];
-                d[j] = temp;
-            } else {
-                if (i == j) {
-                    i++;
-                    j--;
-                }
-                break;
-            }
-        } while (++i <= --j);
-
-        if (j - first < last - i) {
-            if (j > first) {
-                QuickSortDoubleArray(d, first, j);
-            }
-            first = i;
-        } else {
-            if (i < last) {
-                QuickSortDoubleArray(d, i, last);
-            }
-            last = j;
-        }
-    } while (first < last);
-
-}
-
-
 bool CMuArgCtrl::SetBHRThreshold(long TableIndex, double BHRThreshold, long *nUnsafeHH, long *nUnsafeRec)
 {
     long index = TableIndex -1;
-    long i;
+    long i, k;
     long BIRCounter =0;
-    long tempRec, tempHH;
     if ((index <0) || (index >= m_ntab))	{
 	return false;
     }
@@ -5498,35 +8066,148 @@ bool CMuArgCtrl::SetBHRThreshold(long TableIndex, double BHRThreshold, long *nUn
 	}
     }
 
-	tempRec =0;
-	tempHH = 0;
 	CTable *t = &(m_tab[index]);
 	if (t->HasRecode) {
 		t = &(m_tab[m_ntab + index]); // take the recoded one
 	}
 	t->BHRThreshold = BHRThreshold;
 
-	for (i=0; i<m_lNumberOfHH; i++) {
-		if (log(m_HH[i].m_dBHR[BIRCounter])  >= BHRThreshold)	{
-			tempHH++;
-			tempRec = tempRec + m_HH[i].m_lNumberofMembers;
-		}
+	*nUnsafeHH = 0;
+	*nUnsafeRec = 0;
+	if (m_lNumberOfHH == 0) {
+		return true;
+	}
+	if (m_HH.m_nHH == 0) {
+		return false;
 	}
 
-	*nUnsafeHH = tempHH;
-	*nUnsafeRec = tempRec;
+	// the households with a log BHR >= BHRThreshold
+	CBHRIndex &h = FindBHRIndex(BIRCounter);
+	k = std::lower_bound(h.SortLogBHR.begin(), h.SortLogBHR.end(), BHRThreshold) - h.SortLogBHR.begin();
+	*nUnsafeHH = m_lNumberOfHH - k;
+	*nUnsafeRec = h.CumRec[m_lNumberOfHH] - h.CumRec[k];
 	return true;
 }
 
+/**
+ * Finds the highest BHR threshold (see SetBHRThreshold) with at least nUnsafe unsafe
+ * households or records, without setting it
+ * @param TableIndex        1, 2, ..., n_tab index of table
+ * @param UseNumOfHH        True if nUnsafe counts households, false if it counts records
+ * @param nUnsafe           Number of unsafe households or records wanted
+ * @param Threshold         The threshold, the log BHR of a household
+ * @param nUnsafeHH         Number of unsafe households with this threshold
+ * @param nUnsafeRec        Number of records in unsafe households with this threshold
+ * @return false if TableIndex is incorrect, nUnsafe <= 0 or more than there are
+ */
+bool CMuArgCtrl::FindBHRThreshold(long TableIndex, bool UseNumOfHH, long nUnsafe, double *Threshold, long *nUnsafeHH, long *nUnsafeRec)
+{
+    long index = TableIndex -1;
+    long i, k;
+    long BIRCounter =0;
+
+    if ((index <0) || (index >= m_ntab) || nUnsafe <= 0)	{
+	return false;
+    }
+    if (!m_tab[index].IsBIR || m_lNumberOfHH == 0 || m_HH.m_nHH == 0)	{
+	return false;
+    }
+
+    // to find which element of HH.BHR to get
+    for (i=0; i<index; i++)	{
+	if (m_tab[i].IsBIR)	{
+            BIRCounter++;
+	}
+    }
+
+    CBHRIndex &h = FindBHRIndex(BIRCounter);
+    long n = m_lNumberOfHH;
+    if (UseNumOfHH) {
+        if (nUnsafe > n) {
+            return false;
+        }
+        k = n - nUnsafe;
+    }
+    else {
+        if (nUnsafe > h.CumRec[n]) {
+            return false;
+        }
+        // last household k with at least nUnsafe records in the households k, ..., n - 1
+        k = std::upper_bound(h.CumRec.begin(), h.CumRec.begin() + n, h.CumRec[n] - nUnsafe) - h.CumRec.begin() - 1;
+    }
+    *Threshold = h.SortLogBHR[k];
+    k = std::lower_bound(h.SortLogBHR.begin(), h.SortLogBHR.end(), *Threshold) - h.SortLogBHR.begin();
+    *nUnsafeHH = n - k;
+    *nUnsafeRec = h.CumRec[n] - h.CumRec[k];
+
+    return true;
+}
+
+/**
+ * Computes for many thresholds the number of unsafe households and records, as
+ * SetBHRThreshold does, without setting the threshold. The thresholds and the sorted
+ * BHRs of the households are merged in one sweep.
+ * @param TableIndex        1, 2, ..., n_tab index of table
+ * @param nThresholds       Number of thresholds
+ * @param ThresholdArray    The thresholds, log BHRs, in any order
+ * @param nUnsafeHHArray    Per threshold the number of unsafe households
+ * @param nUnsafeRecArray   Per threshold the number of records in unsafe households
+ * @return false if TableIndex is incorrect or there are no households
+ */
+bool CMuArgCtrl::ComputeBHRUnsafeCurve(long TableIndex, long nThresholds, double *ThresholdArray, long *nUnsafeHHArray, long *nUnsafeRecArray)
+{
+    long index = TableIndex -1;
+    long i, j, k = 0;
+    long BIRCounter =0;
+
+    if ((index <0) || (index >= m_ntab) || nThresholds < 0)	{
+	return false;
+    }
+    if (!m_tab[index].IsBIR || m_lNumberOfHH == 0 || m_HH.m_nHH == 0)	{
+	return false;
+    }
+
+    // to find which element of HH.BHR to get
+    for (i=0; i<index; i++)	{
+	if (m_tab[i].IsBIR)	{
+            BIRCounter++;
+	}
+    }
+
+    CBHRIndex &h = FindBHRIndex(BIRCounter);
+    std::vector<long> Order(nThresholds);
+    for (j = 0; j < nThresholds; j++) {
+        Order[j] = j;
+    }
+    std::sort(Order.begin(), Order.end(), CRiskIndexLess(ThresholdArray));
+
+    for (j = 0; j < nThresholds; j++) {
+        double Threshold = ThresholdArray[Order[j]];
+        while (k < m_lNumberOfHH && h.SortLogBHR[k] < Threshold) k++;
+        nUnsafeHHArray[Order[j]] = m_lNumberOfHH - k;
+        nUnsafeRecArray[Order[j]] = h.CumRec[m_lNumberOfHH] - h.CumRec[k];
+    }
+
+    return true;
+}
+
+/**
+ * Computes the BIR threshold for which about nUnsafe records are unsafe in a BIR table.
+ * The risk of every cell is computed from the table, with the cell frequencies as weights
+ * of the records; the data file is not read.
+ * @param TableIndex    Index of the BIR table
+ * @param nUnsafe       Number of unsafe records wanted
+ * @param BIRResult     The threshold found
+ * @param ErrorCode     NOTABLES or NOBIRTAB
+ * @return false if parameters are wrong, the table is not computed or no threshold is found
+ */
 bool CMuArgCtrl::CalculateBIRFreq(long TableIndex, long nUnsafe, double *BIRResult, long *ErrorCode)
 {
-    long i,ind = TableIndex-1;
+    long i, j, ind = TableIndex-1;
     CTable *tab;
-    FILE *fdread;
 
     double *tempBIRarray;
     long  *tempFreqarray;
-    char str[MAXRECORDLENGTH];
     double BIRres;
 
     if (ind < 0 || ind >= m_ntab){
@@ -5543,58 +8224,42 @@ bool CMuArgCtrl::CalculateBIRFreq(long TableIndex, long nUnsafe, double *BIRResu
 	return false;
     }
 
-    if (m_fname[0] == 0){
-	*ErrorCode = NODATAFILE;
-        return false;
-    }
-
-    fdread = fopen(m_fname, "r");
-    if (fdread == 0){
-	*ErrorCode = FILENOTFOUND;
+    if (tab->Cell == 0){
+	*ErrorCode = NOTABLES;
         return false;
     }
 
     tempBIRarray = new double [tab->nCell];
     tempFreqarray = new long [tab->nCell];
-    //initialize array
+
+    // the risk of every cell with records, as the records in it get it
+    CBIRCells &c = FindBIRCells(*tab);
     for (i=0; i<tab->nCell; i++){
     	tempBIRarray[i] = 0;
 	tempFreqarray[i] = tab->Cell[i];
-    }
-    int recnr = 0;
-    int res;
-    if ((!m_InFileIsFixedFormat)&&(m_IgnoreFirstLine)){
-	res = ReadMicroRecord(fdread, str);
-    }
-
-    while (!feof(fdread)){
-	res = ReadMicroRecord(fdread, str);
-	if (++recnr % FIREPROGRESS == 0) {
-            FireUpdateProgress((int)(ftell(fdread) * 100.0 / m_fSize));  // for progressbar in container
-        }
-        switch (res) {
-            case INFILE_ERROR:
-                fclose(fdread);
-		delete[] tempBIRarray;
-		delete[] tempFreqarray;
-		return false;
+	if (tab->Cell[i] <= 0) continue;
+	switch (c.State[i]) {
+            case BIRCELL_VALID:
+            case BIRCELL_MISSING:
+                tempBIRarray[i] = c.Risk[i];
                 break;
-            case INFILE_EOF:
-                goto oke;
+            case BIRCELL_NONE:  // a Missing2, as for a record with that missing code
+            {
+                int DimNr[MAXDIM];
+                long rest = i, freq;
+                double weight, v;
+                for (j = tab->nDim - 1; j >= 0; j--) {
+                    DimNr[j] = rest % tab->SizeDim[j];
+                    rest /= tab->SizeDim[j];
+                }
+                if (GetCellBIR(*tab, DimNr, true, freq, weight, v)) {
+                    tempBIRarray[i] = v;
+                }
                 break;
-            case INFILE_OKE:
-//		if ((!m_InFileIsFixedFormat)&&(m_IgnoreFirstLine)&&(recnr == 1)) {
-//			continue;
-//		}
-//		else {
-                FillBIRArray(*tab,tempBIRarray,str);
-		break;
-//		}
-        }
+            }
+	}
     }
 
-    oke:
-    fclose(fdread);
     // Now sort the stuff
     QuickSortBIRFreqArray(tempBIRarray, tempFreqarray,0,tab->nCell-1);
 
@@ -5620,38 +8285,6 @@ bool CMuArgCtrl::CalculateBIRFreq(long TableIndex, long nUnsafe, double *BIRResu
 }
 
 
-bool CMuArgCtrl::FillBIRArray(CTable &tab, double *BIRarray, char *record)
-{
-    if (!ComputeVarIndices(record)) return false;
-    long CellNr=0;
-    long j;
-    double v;
-    long freq;
-    double weight;
-    bool  HasMissing = false;
-    int DimNr[MAXDIM];
-    for (j =0; j<tab.nDim; j++){
-	CellNr *= tab.SizeDim[j];
-	CellNr += m_var[tab.Varnr[j]].TableIndex;
-	DimNr[j] = m_var[tab.Varnr[j]].TableIndex;
-	if (m_var[tab.Varnr[j]].TableIsMissing){
-            HasMissing = true;
-	}
-    }
-    assert(tab.GetCellNr(DimNr) == CellNr);
-    bool temp;
-    freq = tab.Cell[CellNr];
-    if (freq >0 ) {
-	if (AddMissing(tab,DimNr,freq,weight, HasMissing)) {
-            temp = BaseIndividualRisk(freq,weight,&v);
-            assert(temp);
-            BIRarray[CellNr] = v;
-	}
-    }
-    return true;
-}
-
-
 void CMuArgCtrl::QuickSortBIRFreqArray(double * BIR, long *Freq, int first, int last)
 {
     int i, j;
@@ -5757,11 +8390,6 @@ bool CMuArgCtrl::CalculateBHRFreq(long TableIndex, bool UseNumOfHH, long nUnsafe
     long ind = TableIndex -1;
     long i, BIRCounter=0;
     CTable *tab;
-    double *tempBHRarray;
-    long *tempFreqarray;
-    long tempUnsafeHH=0;
-    long tempUnsafeRec =0;
-    double BHRRes;
     if ((ind < 0) || (ind >= m_ntab)){
 	*ErrCode = NOTABLES;
 	return false;
@@ -5773,7 +8401,7 @@ bool CMuArgCtrl::CalculateBHRFreq(long TableIndex, bool UseNumOfHH, long nUnsafe
 	return false;
     }
 
-    if (m_lNumberOfHH==0){
+    if (m_lNumberOfHH==0 || m_HH.m_nHH == 0){
 	*ErrCode = NOHOUSEHOLDS;
 	return false;
     }
@@ -5787,49 +8415,20 @@ bool CMuArgCtrl::CalculateBHRFreq(long TableIndex, bool UseNumOfHH, long nUnsafe
 	}
     }
 
-    tempBHRarray = new double [m_lNumberOfHH];
-    for (i=0; i<m_lNumberOfHH; i++){
-	tempBHRarray [i] = m_HH[i].m_dBHR[BIRCounter];
-    }
+    CBHRIndex &h = FindBHRIndex(BIRCounter);
     if (UseNumOfHH){
-	QuickSortDoubleArray(tempBHRarray, 0, m_lNumberOfHH-1);
-	for (i=0; i<m_lNumberOfHH; i++){
-            tempUnsafeHH++;
-            if (tempUnsafeHH > nUnsafeHH){
-		break;
-            }
-	}
-
-	if ((i == m_lNumberOfHH) || (i==0)){
-            delete[] tempBHRarray;
-            return false;
-	}
-	BHRRes = tempBHRarray[i-1];
-	*ResBHR = BHRRes;
+	// the nUnsafeHH-th lowest BHR
+	i = nUnsafeHH;
     }
     else{
-	tempFreqarray = new long [m_lNumberOfHH];
-	for (i=0; i< m_lNumberOfHH; i++){
-            tempFreqarray[i] = m_HH[i].m_lNumberofMembers;
-	}
-
-        QuickSortBIRFreqArray(tempBHRarray, tempFreqarray, 0, m_lNumberOfHH-1);
-	for (i=0; i<m_lNumberOfHH; i++){
-            tempUnsafeRec = tempUnsafeRec + tempFreqarray[i];
-            if (tempUnsafeRec > nUnsafeRec){
-		break;
-            }
-	}
-	if ((i == m_lNumberOfHH) || (i==0)){
-            delete[] tempBHRarray;
-            delete[] tempFreqarray;
-            return false;
-	}
-	BHRRes = tempBHRarray[i-1];
-	*ResBHR = BHRRes;
+	// the first household i at which the records of the households 0, ..., i exceed nUnsafeRec
+	i = std::upper_bound(h.CumRec.begin() + 1, h.CumRec.end(), nUnsafeRec) - (h.CumRec.begin() + 1);
+    }
+    if ((i >= m_lNumberOfHH) || (i <= 0)){
+	return false;
     }
+    *ResBHR = h.SortBHR[i-1];
 
-    delete[] tempBHRarray;
     return true;
 }
 
@@ -6000,7 +8599,7 @@ bool CMuArgCtrl::CombineToSafeFile(std::string FileName, long *nSupps, bool With
 {
     std::string sFileName;
     sFileName = FileName;
-    FILE *fd_in, *fd_out;
+    FILE *fd_in, *fd_out, *fd_safe;
     char str[MAXRECORDLENGTH];
     char orgstr[MAXRECORDLENGTH];
     int i, j, recnr, nRecHH = 1;
@@ -6077,6 +8676,15 @@ bool CMuArgCtrl::CombineToSafeFile(std::string FileName, long *nSupps, bool With
     if (fd_out == 0) {
 	return false;
     }
+    // from a grouped copy of the data file: the records are restored to the order of the data file at the end
+    fd_safe = fd_out;
+    if (m_GroupSeqFile != 0 && !m_WriteRandom) {
+        fd_out = tmpfile();
+        if (fd_out == 0) {
+            fclose(fd_safe);
+            return false;
+        }
+    }
 
     if (m_OutFileIsFixedFormat) {
     	MakeRecordDescription( HHIdentOption); // If FileName empty: no *.rda written
@@ -6137,6 +8745,12 @@ bool CMuArgCtrl::CombineToSafeFile(std::string FileName, long *nSupps, bool With
   fclose(fd_test);
 #endif // SHOWUNSAFE
 
+    if (fd_out != fd_safe) {
+        if (!RestoreRecordOrder(fd_out, fd_safe)) {
+            goto error;
+        }
+        fclose(fd_safe);
+    }
     fclose(fd_in);
     fclose(fd_out);
     delete [] InvolvedVar;
@@ -6147,7 +8761,54 @@ bool CMuArgCtrl::CombineToSafeFile(std::string FileName, long *nSupps, bool With
 error:
     fclose(fd_in);
     fclose(fd_out);
+    if (fd_out != fd_safe) {
+        fclose(fd_safe);
+    }
     delete [] InvolvedVar;
 
     return false;
 }
+
+/**
+ * Sets whether subtables that are provably safe are still computed
+ * A subtable is pruned if a table with the same variables and more has no non-zero cell
+ * on or below the threshold, missings included. Pruned subtables are never scanned for unsafe cells.
+ * @param SkipMaterialize   true: do not compute the cells of pruned subtables either,
+ *                          except for one dimensional and BIR tables
+ * @return true
+ */
+bool CMuArgCtrl::SetSubTablePruning(bool SkipMaterialize)
+{
+    m_SkipPrunedTables = SkipMaterialize;
+    return true;
+}
+
+/**
+ * Number of subtables pruned by the last ComputeTables or ApplyRecode
+ * @return number of pruned subtables
+ */
+long CMuArgCtrl::NumberOfPrunedSubTables()
+{
+    return m_nPrunedUC;
+}
+
+/**
+ * Sets whether ExploreFile groups the records of a household file on HHIdent, so the records
+ * of a household need not be contiguous in the data file. The records are sorted on HHIdent
+ * by an external merge sort of their file positions and copied in that order to GroupFileName,
+ * which is used instead of the data file until the next ExploreFile or CleanAll removes it.
+ * So WriteVariablesInFile writes the variables in the order of the grouped copy, whatever
+ * data file it is given, and the changed values read back by MakeFileSafe (see
+ * SetChangeFile) go to the right records.
+ * A data file with contiguous households is not copied. Call before ExploreFile
+ * @param GroupFileName     Name of the grouped copy, empty for no grouping
+ * @param KeepRecordOrder   true: MakeFileSafe and CombineToSafeFile write the records in the
+ *                          order of the data file, false: in the order of the grouped copy
+ * @return true
+ */
+bool CMuArgCtrl::SetHouseholdGrouping(std::string GroupFileName, bool KeepRecordOrder)
+{
+    m_GroupFileName = GroupFileName;
+    m_KeepRecordOrder = KeepRecordOrder;
+    return true;
+}
@@ -25,6 +25,7 @@
 #include "globals.h"
 #include "ChSafeVarInfo.h"
 #include "UCList.h"
+#include "Recode.h"
 #include "VarList.h"
 
 
@@ -53,6 +54,12 @@ public:
             m_UCList = 0;
 
             m_nUC = 0;
+            m_nPrunedUC = 0;
+            m_SkipPrunedTables = false;
+            m_UCProfileValid = false;
+            m_RecodeTablesValid = false;
+            m_RecodeCacheClock = 0;
+            m_BIRCellsValid = false;
             m_unsafe = 0;
             m_varlist = 0;
             m_PramVarIndex = -1;
@@ -67,13 +74,16 @@ public:
             m_NumberofRecs = -1;
             m_StringsInQuotes = false;
 
-            m_HH = 0;
             CurrentHHName = "";
             LastHHName = "";
             m_lNumberOfHH = 0;
             m_bHasHH = false;
             m_bHasBIR = false;
             m_lNumBIRs = 0;
+            m_RecCodesValid = false;
+            m_KeepRecordOrder = false;
+            m_FileGrouped = false;
+            m_GroupSeqFile = 0;
 	}
 	~CMuArgCtrl()
 	{
@@ -124,6 +134,32 @@ private:
 
 	long m_cuc;
 	long m_nUC;
+	long m_nPrunedUC;          // number of subtables found safe by a safe superset table
+	bool m_SkipPrunedTables;   // true: do not compute the cells of pruned subtables
+
+	std::vector<int> m_UCHash;                // open hash on variable combination, first index in UCList
+	std::vector<int> m_UCNext;                // next index in UCList with the same variable combination
+	std::vector<int> m_UCDimList[MAXDIM + 1]; // per dimension the biggestThreshold entries of UCList
+
+	std::vector<int> m_UCProfile;             // per variable, code and dimension the number of unsafe cells
+	std::vector<long> m_UCProfileStart;       // per variable the start in m_UCProfile
+	std::vector<int> m_UCProfileMaxDim;       // per variable the highest dimension of a table with it
+	bool m_UCProfileValid;                    // false: tables or codes changed, compute again
+
+	std::vector<bool> m_VarRecodeChanged;     // per variable: recode changed since last ApplyRecode
+	bool m_RecodeTablesValid;                 // recoded tables computed, only changed ones need an update
+
+	std::vector< std::vector<CRecodedTables> > m_RecodedTablesCache; // per base table the tables of recently used recode versions
+	std::vector<CRecodedTables> m_TabStash;   // per base table during ApplyRecode: the tables of the previous versions
+	std::vector<CRecodedTables> m_TabRestore; // per base table during ApplyRecode: the tables of the current versions from the cache
+	std::vector<int> m_TabVersion;            // per base table and dimension the recode version of its (sub)tables
+	long m_RecodeCacheClock;
+
+	std::vector<CLevelTable> m_LevelTab;      // base tables with a hierarchical variable at one of its levels
+
+	std::vector<CBIRCells> m_BIRCells;        // BIR (sub)tables with the missings added per cell
+	bool m_BIRCellsValid;                     // false: tables or codes changed, compute again
+	std::vector<CBHRIndex> m_BHRIndex;        // per BIR table the sorted households, empty: compute again
 
 	int (*m_unsafe)[MAXDIM + 1];  // first one for freq, others dim 1, 2, ...
 
@@ -136,6 +172,8 @@ private:
 
 	//CString m_WarningRecode;
         std::string m_WarningRecode;
+        std::string m_CodeString;  // codes returned by UnsafeVariableAllCodes and GetVarCodes
+        std::string m_SearchRecodeString;  // recode returned by SearchRecode
 
 	int m_nvarpos;
 	CVarList *m_varlist;        // Data positions from source to safe record
@@ -153,10 +191,19 @@ private:
 	int m_nUnsafe;
 
 	//Household
-	CHousehold *m_HH;
+	CHouseholds m_HH;
 	long m_lNumberOfHH;
 	std::string CurrentHHName ;
 	std::string LastHHName;
+	std::vector<long> m_HHnRec;       // per household the number of records, see ExploreFile
+	std::vector<int> m_RecVars;         // the variables of the BIR tables, their codes are kept per record
+	std::vector<int> m_RecCodeIndex;    // per record the code index of every m_RecVars variable, see ComputeTables
+	std::vector<bool> m_RecCodeMissing; // per record whether that code is a missing
+	bool m_RecCodesValid;               // codes of all records kept, so the BHRs need no pass over the file
+	std::string m_GroupFileName;        // copy of the data file with the records grouped on HHIdent, see SetHouseholdGrouping
+	bool m_KeepRecordOrder;             // write the safe file in the record order of the data file
+	bool m_FileGrouped;                 // m_fname is the grouped copy
+	FILE *m_GroupSeqFile;               // per record of the grouped copy its number in the data file, if m_KeepRecordOrder
 	bool m_bHasHH;
 	bool m_bHasBIR;
 	long m_lNumBIRs;
@@ -173,62 +220,110 @@ private:
 	void AddSpacesBefore(std::string& str, int len);
 	void AddSpacesBefore(char *str, int len);
 
+	void ReadTableCode(char *str, CVariable *var, long Index, char *code);
 	bool ComputeTableIndex(char *str, CVariable *var, long Index);
+	int ComputeTableIndex(char *str, CVariable *var, long Index, bool& IsMissing);
 	void FillTables(char *str);
 	void AddTableCell(CTable& t, double Weight);
 	int  ComputeSubTableList();
+	void ComputeUCListTable(int i, int maxdim, CTable &t, int &nTables, int IsBIR);
+	void ComputeUCListUnsafe(int i);
+	int  UpdateSubTableList();
+	void SetRecodeChanged(int v);
+	bool IsRecodeChanged(int nDim, const int *Varnr);
+	void GetTableRecodeVersion(int iTab, int *Version);
+	bool SwapRecodedTables(int iTab);
+	void FreeRecodedTables(CRecodedTables &rt);
+	void ClearRecodedTablesCache();
 	void DoSubTableList(int iTab, int niv, int from, int *vars, int CVar);
 	int  ComputeSubTable(CTable &BaseTable, CTable &SubTable);
 	void MakeSubTable(CTable& BaseTab, CTable& SubTab, int niv, int iParentCell, int iSubCell, int *tabvars);
 	bool ComputeUnsafeCells(CTable & t, int CVar);
 	void ComputeNumberUnsafeCells(CTable & t, int niv, int cindex, bool IsMissingCode, int CVar = -1, int code = -1);
-	void SortUCList(int n, CUCList *uc);
-	void QuickSortUCList(CUCList *s, int first, int last);
-	int  CompareUCListThres(CUCList& a, CUCList& b);
+	bool ComputeUnsafeProfile();
+	void ComputeUnsafeProfileCells(CTable & t, int niv, int cindex, bool IsMissingCode, int *codes);
+	void SortUCList(int n, CUCList *&uc);
+	void QuickSortUCList(CUCKey *s, int first, int last);
+	int  CompareUCListThres(CUCKey& a, CUCKey& b);
 	int  CompareUCList(CUCList& a, CUCList& b);
+	void BuildUCIndex();
+	int  HashUCVars(int nDim, const int *Varnr);
+	int  FindUCList(int nDim, const int *Varnr);
+	int  ComputeMinFreq(CTable& t);
 
 	void SetTableHasRecode();
 
 	bool ComputeRecodeTables();
 	bool ComputeRecodeTable(CTable & srctab, CTable & dsttab);
-	void ComputeRecodeTableCells(CTable & srctab, CTable & dsttab, int niv, int iCellSrc, int iCellDst);
-
-	int  SetCode2Recode(int VarIndex, char *DestCode,char *SrcCode1, char *SrcCode2, int fromto);
-	bool ParseRecodeString(long VarIndex, const char *RecodeString, long *ErrorType, long *ErrorLine, long *ErrorPos, int Phase);
+	bool ComputeRecodeTable(CTable & srctab, CTable & dsttab, int **DestCode);
+	void EvaluateRecodeCandidate(int v, int *DestCode, int nCode, int nMissing, long *UCArray);
+	long CountUnsafeCells(CTable & t, const int *nValid);
+
+	bool PrepareRecodeSearch(int v, std::vector<CRecodeSearchTable> &Tables, std::vector<double> &Freq);
+	void AddRecodeSearchTable(CTable &t, const int *nValid, int v, std::vector<CRecodeSearchTable> &Tables, std::vector<double> *Freq);
+	void MakeRecodeSearchState(const std::vector<CRecodeSearchTable> &Tables, const std::vector<double> &Freq, const std::vector<int> &First, CRecodeSearchState &State);
+	void SetRecodeSearchCost(CRecodeSearchState &State, double Entropy, double LossWeight);
+	long MergeUnsafeDelta(const std::vector<CRecodeSearchTable> &Tables, const CRecodeSearchState &State, int g);
+	void MergeRecodeGroups(const std::vector<CRecodeSearchTable> &Tables, CRecodeSearchState &State, int g);
+	double GroupEntropy(const std::vector<double> &Freq);
+	std::string MakeGroupRecodeString(int v, const std::vector<int> &First);
+
+	std::string NormalizeRecodeSpec(const char *RecodeString, const char *eMissing1, const char *eMissing2);
+	bool MakeTruncate(int v, int nPos);
+	void ComputeLevelTables(int v);
+	void FreeLevelTables(int v);
+	int  FindLevelTable(int iTab);
+	bool MakeRecode(int v, const char *RecodeString, const char *eMissing1, const char *eMissing2, long *ErrorType, long *ErrorLine, long *ErrorPos);
+	int  FindRecodeSource(int VarIndex, const std::string &code, bool &Exact, bool &IsMissing);
+	void ResolveRecodeRule(int VarIndex, RECODERULE &rule);
+	int  NextUnfilled(std::vector<int> &Unfilled, int c);
+	bool ParseRecodeString(long VarIndex, const char *RecodeString, std::vector<RECODERULE> &Rules, long *ErrorType, long *ErrorLine, long *ErrorPos);
         //bool ParseRecodeString(long VarIndex, std::string RecodeString, long *ErrorType, long *ErrorLine, long *ErrorPos, int Phase);
-	bool ParseRecodeStringLine(long VarIndex, const char *str, long *ErrorType, long *ErrorPos, int Phase);
+	bool ParseRecodeStringLine(long VarIndex, const char *str, std::vector<RECODERULE> &Rules, int LineNumber, long *ErrorType, long *ErrorPos);
         //bool ParseRecodeStringLine(long VarIndex, std::string str, long *ErrorType, long *ErrorPos, int Phase);
 	int  ReadWord(const char *str, char* CodeFrom, char *CodeTo, char EndCode, int& fromto, int& pos);
 
 	bool WriteVariablesFromMicroRecord(char *str, FILE *fdout, long *VarIndexes,long nVar, std::string seperator);
 
-	bool AddMissingTable(CTable & t, int niv, int *DimNr, bool HasMissing, int type, double *Ksi, double MaxRisk, long * Frequency=0);
 	int  AddMissing(const CTable& tab, int *DimNr, long& freq, double& weight, bool HasMissing);
 	void AddMissingCells(CTable& t, int *dimnr, int *nMissing, long& freq, double& weight);
+	CBIRCells& FindBIRCells(CTable &t);
+	bool GetCellBIR(CTable &t, int *DimNr, bool HasMissing, long& freq, double& weight, double& risk);
+	CBIRCells& FindBIRIndex(CTable &t);
+	CBHRIndex& FindBHRIndex(long BIRCounter);
+	void HistogramClassStart(const std::vector<double> &x, double MinValue, double ClassWidth, long nClasses, std::vector<long> &Start);
 
 	bool MakeRecordDescription(long HHIdentOption);
 	bool MakeFreeRecordDescription(long HHIdentOption);
 	void QuickSortStringArray(std::vector<std::string> &s, int first, int last);
 	bool DoEntropy(long VarNr, double& Entropy);
-	bool MakeRecordSafe(char *record, int fase, int recnr, int nRecHH, long HHNum);
+	bool MakeRecordSafe(char *record, int fase, int recnr, int nRecHH, long HHNum, CSafeRecordState &s);
 	bool ComputeVarIndices(char *record);
-	int  ComputeRecordUC(long HHNum);
-	void SetVarMissing(int iVar);
-	double SetFreqMissings(std::vector<unsigned int>& FreqMissing, int nRecHH);
+	bool ComputeVarIndices(char *record, CSafeRecordState &s);
+	int  ComputeRecordUC(long HHNum, CSafeRecordState &s);
+	void SetVarMissing(int iVar, CSafeRecordState &s);
+	double SetFreqMissings(std::vector<unsigned int>& FreqMissing, int nRecHH, CSafeRecordState &s);
 	int GetHHSizeFactor(int VarIndex, int nRecHH);
-	double SetMinMissings(std::vector<unsigned int>& MinMissing, int nRecHH);
+	double SetMinMissings(std::vector<unsigned int>& MinMissing, int nRecHH, CSafeRecordState &s);
+	bool MakeBlockSafe(CSafeFileBlock &Block);
+	void WriteBlock(FILE *fd_out, CSafeFileBlock &Block, long HHIdentOption, bool PrintBIR);
 	bool WriteRecord(FILE *fd_out, char *record, long HHIdentOption, long recnr, bool WithBHR, long HHNum, bool PrintBIR, char *origrecord);
 	bool IsInOutputFile(long VarIndex, long *FileNum, long *ArrIndex);
 	int GetRandomInteger();
-	int ComputeRecHH(FILE *fd, int bpos, int npos);
-	bool DoCompleteHH(FILE *fd, FILE *fd_out, long StartPos, int n_rec, int *InvolvedVar, int recnr, long HHIdentOption, long HHNum, bool PrintBIR);
+	bool DoCompleteHH(CSafeFileBlock &Block, long h, CSafeRecordState &s);
 	void ComputeTableBIR(CTable &t, int& BIRFreq, double& BIRWeight, double& BIR);
 
 	bool NumberOfHH(char *str, long &HHNumbers);
-	bool IsNewHH(char *str);
+	bool GroupHouseholdFile(FILE *fd, long *ErrorCode, long *LineNumber, bool *Grouped);
+	bool RestoreRecordOrder(FILE *fd_grouped, FILE *fd_out);
+	int  ReadWholeLine(FILE *fd, std::string &Line);
+	void ClearHouseholdGrouping();
 	bool FindBIRForRec(char *str, double *BIRarray);
-	void QuickSortDoubleArray(double *d, int first, int last);
-	bool FillBIRArray(CTable &tab, double *BIRarray, char *record);
+	bool FindBIRForRecNr(long RecNr, std::vector<int>& VarIndex, std::vector<bool>& VarMissing, double *BIRarray);
+	void ComputeRecBIR(const std::vector<int>& VarIndex, const std::vector<bool>& VarMissing, double *BIRarray);
+	void PrepareRecCodes();
+	bool CalculateHouseholdRiskFromCodes();
+	void SaveRecCodes();
 	void QuickSortBIRFreqArray(double * BIR, long *Freq, int first, int last);
 	double FindBIRforNumIterations(double BIR0, long NumIter, long nUnsafe, double *BIRArray, long *FreqArray, CTable &t);
         
@@ -280,6 +375,7 @@ public:
 	long GetMaxnUC();
 	bool ComputeTables(/*[in]*/ long *ErrorCode, /*[in]*/ long *TableIndex);
 	bool BaseIndividualRisk(/*[in]*/ long fk,/*[in]*/  double Fk,/*[in,out]*/  double *risk);
+	bool BaseIndividualRiskArray(/*[in]*/ long n, /*[in,out]*/ long *fkArray, /*[in,out]*/ double *FkArray, /*[in,out]*/ double *RiskArray, /*[in]*/ bool Memoize);
 	bool SetTable(/*[in]*/ long TabIndex, /*[in]*/ long Threshold, /*[in]*/ long nDim, /*[in,out]*/ long *VarList, /*[in]*/ bool IsBIR,long BIRWeightVarIndex);
 	bool SetNumberTab(/*[in]*/ long nTab);
 	bool ExploreFile(/*[in]*/ std::string FileName,/*[in]*/  long *ErrorCode,/*[in]*/  long *LineNumber, /*[in]*/ long *VarIndex);
@@ -288,6 +384,25 @@ public:
         bool GetErrorString(/*[in]*/ long ErrorCode, /*[in,out]*/ const char** ErrorString);
         bool MakeAnonFile(/*[in]*/ std::string FileName, /*[in]*/ long nVar, /*[in,out]*/ long *VarIndexes, /*[in]*/ std::string seperator, /*[in,out]*/ long *ErrorCode);
         bool CombineToSafeFile(/*[in]*/ std::string FileName, /*[in]*/ long *nSupps, /*[in]*/ bool WithPrior,/*[in]*/ bool WithEntropy,/*[in]*/ long HHIdentOption,/*[in]*/ bool RandomizeOutput,/*[in]*/ bool PrintBHR);
+        bool SetSubTablePruning(/*[in]*/ bool SkipMaterialize);
+        long NumberOfPrunedSubTables();
+        bool UnsafeVariableAllCodes(/*[in]*/ long VarIndex, /*[in]*/ long nCodes, /*[in,out]*/ long *MissingArray, /*[in,out]*/ long *FreqArray, /*[in,out]*/ long *Count, /*[in,out]*/ long *UCArray, /*[in,out]*/ const char **CodeString);
+        bool GetVarCodes(/*[in]*/ long VarIndex, /*[in]*/ long nCodes, /*[in,out]*/ const char **CodeString, /*[in,out]*/ long *PramPercArray);
+        bool GetUnsafeCells(/*[in]*/ long nDim, /*[in]*/ long Index, /*[in]*/ long StartCell, /*[in]*/ long MaxCells, /*[in,out]*/ long *nCells, /*[in,out]*/ long *CodeArray, /*[in,out]*/ long *FreqArray, /*[in,out]*/ double *WeightArray, /*[in,out]*/ long *NextCell);
+        bool EvaluateRecodes(/*[in]*/ long VarIndex, /*[in]*/ long nCandidates, /*[in]*/ char *RecodeStrings[], /*[in]*/ const char *eMissing1, /*[in]*/ const char *eMissing2, /*[in,out]*/ long *ErrorTypeArray, /*[in,out]*/ long *nCodeArray, /*[in,out]*/ long *Count, /*[in,out]*/ long *UCArray);
+        bool SearchRecode(/*[in]*/ long VarIndex, /*[in]*/ long MaxSteps, /*[in]*/ long BeamWidth, /*[in]*/ double LossWeight, /*[in,out]*/ long *nCode, /*[in,out]*/ long *nUnsafe, /*[in,out]*/ double *EntropyLoss, /*[in,out]*/ const char **RecodeString);
+        bool SearchTruncate(/*[in]*/ long VarIndex, /*[in]*/ double LossWeight, /*[in,out]*/ long *nPos, /*[in,out]*/ long *nUnsafe, /*[in,out]*/ double *EntropyLoss);
+        bool SetHierarchyPrefix(/*[in]*/ long VarIndex, /*[in]*/ long nLevels, /*[in,out]*/ long *PrefixLength);
+        bool AddHierarchyLevel(/*[in]*/ long VarIndex, /*[in]*/ const char *RecodeString, /*[in,out]*/ long *ErrorType, /*[in,out]*/ long *ErrorLine, /*[in,out]*/ long *ErrorPos);
+        bool ClearHierarchy(/*[in]*/ long VarIndex);
+        bool DoHierarchyLevel(/*[in]*/ long VarIndex, /*[in]*/ long Level);
+        bool FindBIRThreshold(/*[in]*/ long TabIndex, /*[in]*/ long nUnsafe, /*[in,out]*/ double *Threshold, /*[in,out]*/ long *nUnsafeFound);
+        bool FindBIRMaxRisk(/*[in]*/ long TabIndex, /*[in]*/ double ReIdentRate, /*[in,out]*/ double *MaxRisk);
+        bool ComputeBIRUnsafeCurve(/*[in]*/ long TabIndex, /*[in]*/ long nThresholds, /*[in,out]*/ double *ThresholdArray, /*[in,out]*/ long *nUnsafeArray);
+        bool ComputeBIRRateCurve(/*[in]*/ long TabIndex, /*[in]*/ long nRisks, /*[in,out]*/ double *MaxRiskArray, /*[in,out]*/ double *ReIdentRateArray);
+        bool ComputeBHRUnsafeCurve(/*[in]*/ long TableIndex, /*[in]*/ long nThresholds, /*[in,out]*/ double *ThresholdArray, /*[in,out]*/ long *nUnsafeHHArray, /*[in,out]*/ long *nUnsafeRecArray);
+        bool FindBHRThreshold(/*[in]*/ long TableIndex, /*[in]*/ bool UseNumOfHH, /*[in]*/ long nUnsafe, /*[in,out]*/ double *Threshold, /*[in,out]*/ long *nUnsafeHH, /*[in,out]*/ long *nUnsafeRec);
+        bool SetHouseholdGrouping(/*[in]*/ std::string GroupFileName, /*[in]*/ bool KeepRecordOrder);
 };
 
 #endif //__NEWMUARGCTRL_H_
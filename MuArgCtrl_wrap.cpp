@@ -3136,6 +3136,41 @@ SWIGEXPORT jboolean JNICALL Java_muargus_extern_dataengine_MuArgusCtrlJNI_CMuArg
 }
 
 
+SWIGEXPORT jboolean JNICALL Java_muargus_extern_dataengine_MuArgusCtrlJNI_CMuArgCtrl_1BaseIndividualRiskArray(JNIEnv *jenv, jclass jcls, jlong jarg1, jobject jarg1_, jint jarg2, jintArray jarg3, jdoubleArray jarg4, jdoubleArray jarg5, jboolean jarg6) {
+  jboolean jresult = 0 ;
+  CMuArgCtrl *arg1 = (CMuArgCtrl *) 0 ;
+  long arg2 ;
+  long *arg3 = (long *) 0 ;
+  double *arg4 = (double *) 0 ;
+  double *arg5 = (double *) 0 ;
+  bool arg6 ;
+  jint *jarr3 ;
+  jdouble *jarr4 ;
+  jdouble *jarr5 ;
+  bool result;
+  
+  (void)jenv;
+  (void)jcls;
+  (void)jarg1_;
+  arg1 = *(CMuArgCtrl **)&jarg1; 
+  arg2 = (long)jarg2; 
+  if (!SWIG_JavaArrayInLong(jenv, &jarr3, (long **)&arg3, jarg3)) return 0; 
+  if (!SWIG_JavaArrayInDouble(jenv, &jarr4, (double **)&arg4, jarg4)) return 0; 
+  if (!SWIG_JavaArrayInDouble(jenv, &jarr5, (double **)&arg5, jarg5)) return 0; 
+  arg6 = jarg6 ? true : false; 
+  result = (bool)(arg1)->BaseIndividualRiskArray(arg2,arg3,arg4,arg5,arg6);
+  jresult = (jboolean)result; 
+  SWIG_JavaArrayArgoutLong(jenv, jarr3, (long *)arg3, jarg3); 
+  SWIG_JavaArrayArgoutDouble(jenv, jarr4, (double *)arg4, jarg4); 
+  SWIG_JavaArrayArgoutDouble(jenv, jarr5, (double *)arg5, jarg5); 
+  delete [] arg3; 
+  delete [] arg4; 
+  delete [] arg5; 
+  return jresult;
+}
+
+
+
 SWIGEXPORT jboolean JNICALL Java_muargus_extern_dataengine_MuArgusCtrlJNI_CMuArgCtrl_1SetTable(JNIEnv *jenv, jclass jcls, jlong jarg1, jobject jarg1_, jint jarg2, jint jarg3, jint jarg4, jintArray jarg5, jboolean jarg6, jint jarg7) {
   jboolean jresult = 0 ;
   CMuArgCtrl *arg1 = (CMuArgCtrl *) 0 ;
@@ -3456,6 +3491,929 @@ SWIGEXPORT jboolean JNICALL Java_muargus_extern_dataengine_MuArgusCtrlJNI_CMuArg
 }
 
 
+SWIGEXPORT jboolean JNICALL Java_muargus_extern_dataengine_MuArgusCtrlJNI_CMuArgCtrl_1SetSubTablePruning(JNIEnv *jenv, jclass jcls, jlong jarg1, jobject jarg1_, jboolean jarg2) {
+  jboolean jresult = 0 ;
+  CMuArgCtrl *arg1 = (CMuArgCtrl *) 0 ;
+  bool arg2 ;
+  bool result;
+  
+  (void)jenv;
+  (void)jcls;
+  (void)jarg1_;
+  arg1 = *(CMuArgCtrl **)&jarg1; 
+  arg2 = jarg2 ? true : false; 
+  result = (bool)(arg1)->SetSubTablePruning(arg2);
+  jresult = (jboolean)result; 
+  return jresult;
+}
+
+
+SWIGEXPORT jint JNICALL Java_muargus_extern_dataengine_MuArgusCtrlJNI_CMuArgCtrl_1NumberOfPrunedSubTables(JNIEnv *jenv, jclass jcls, jlong jarg1, jobject jarg1_) {
+  jint jresult = 0 ;
+  CMuArgCtrl *arg1 = (CMuArgCtrl *) 0 ;
+  long result;
+  
+  (void)jenv;
+  (void)jcls;
+  (void)jarg1_;
+  arg1 = *(CMuArgCtrl **)&jarg1; 
+  result = (long)(arg1)->NumberOfPrunedSubTables();
+  jresult = (jint)result; 
+  return jresult;
+}
+
+
+SWIGEXPORT jboolean JNICALL Java_muargus_extern_dataengine_MuArgusCtrlJNI_CMuArgCtrl_1UnsafeVariableAllCodes(JNIEnv *jenv, jclass jcls, jlong jarg1, jobject jarg1_, jint jarg2, jint jarg3, jintArray jarg4, jintArray jarg5, jintArray jarg6, jintArray jarg7, jobjectArray jarg8) {
+  jboolean jresult = 0 ;
+  CMuArgCtrl *arg1 = (CMuArgCtrl *) 0 ;
+  long arg2 ;
+  long arg3 ;
+  long *arg4 = (long *) 0 ;
+  long *arg5 = (long *) 0 ;
+  long *arg6 = (long *) 0 ;
+  long *arg7 = (long *) 0 ;
+  char **arg8 = (char **) 0 ;
+  jint *jarr4 ;
+  jint *jarr5 ;
+  long temp6 ;
+  jint *jarr7 ;
+  char *temp8 ;
+  bool result;
+  
+  (void)jenv;
+  (void)jcls;
+  (void)jarg1_;
+  arg1 = *(CMuArgCtrl **)&jarg1; 
+  arg2 = (long)jarg2; 
+  arg3 = (long)jarg3; 
+  if (!SWIG_JavaArrayInLong(jenv, &jarr4, (long **)&arg4, jarg4)) return 0; 
+  if (!SWIG_JavaArrayInLong(jenv, &jarr5, (long **)&arg5, jarg5)) return 0; 
+  {
+    if (!jarg6) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaNullPointerException, "array null");
+      return 0;
+    }
+    if (jenv->GetArrayLength(jarg6) == 0) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaIndexOutOfBoundsException, "Array must contain at least 1 element");
+      return 0;
+    }
+    temp6 = (long)0;
+    arg6 = &temp6; 
+  }
+  if (!SWIG_JavaArrayInLong(jenv, &jarr7, (long **)&arg7, jarg7)) return 0; 
+  {
+    if (!jarg8) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaNullPointerException, "array null");
+      return 0;
+    }
+    if (jenv->GetArrayLength(jarg8) == 0) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaIndexOutOfBoundsException, "Array must contain at least 1 element");
+      return 0;
+    }
+    arg8 = &temp8; 
+    *arg8 = 0;
+  }
+  result = (bool)(arg1)->UnsafeVariableAllCodes(arg2,arg3,arg4,arg5,arg6,arg7,(char const **)arg8);
+  jresult = (jboolean)result; 
+  SWIG_JavaArrayArgoutLong(jenv, jarr4, (long *)arg4, jarg4); 
+  SWIG_JavaArrayArgoutLong(jenv, jarr5, (long *)arg5, jarg5); 
+  {
+    jint jvalue = (jint)temp6;
+    jenv->SetIntArrayRegion(jarg6, 0, 1, &jvalue);
+  }
+  SWIG_JavaArrayArgoutLong(jenv, jarr7, (long *)arg7, jarg7); 
+  {
+    jstring jnewstring = NULL;
+    if (arg8) {
+      jnewstring = jenv->NewStringUTF(*arg8);
+    }
+    jenv->SetObjectArrayElement(jarg8, 0, jnewstring); 
+  }
+  delete [] arg4; 
+  delete [] arg5; 
+  delete [] arg7; 
+  
+  return jresult;
+}
+
+
+SWIGEXPORT jboolean JNICALL Java_muargus_extern_dataengine_MuArgusCtrlJNI_CMuArgCtrl_1GetVarCodes(JNIEnv *jenv, jclass jcls, jlong jarg1, jobject jarg1_, jint jarg2, jint jarg3, jobjectArray jarg4, jintArray jarg5) {
+  jboolean jresult = 0 ;
+  CMuArgCtrl *arg1 = (CMuArgCtrl *) 0 ;
+  long arg2 ;
+  long arg3 ;
+  char **arg4 = (char **) 0 ;
+  long *arg5 = (long *) 0 ;
+  char *temp4 ;
+  jint *jarr5 ;
+  bool result;
+  
+  (void)jenv;
+  (void)jcls;
+  (void)jarg1_;
+  arg1 = *(CMuArgCtrl **)&jarg1; 
+  arg2 = (long)jarg2; 
+  arg3 = (long)jarg3; 
+  {
+    if (!jarg4) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaNullPointerException, "array null");
+      return 0;
+    }
+    if (jenv->GetArrayLength(jarg4) == 0) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaIndexOutOfBoundsException, "Array must contain at least 1 element");
+      return 0;
+    }
+    arg4 = &temp4; 
+    *arg4 = 0;
+  }
+  if (!SWIG_JavaArrayInLong(jenv, &jarr5, (long **)&arg5, jarg5)) return 0; 
+  result = (bool)(arg1)->GetVarCodes(arg2,arg3,(char const **)arg4,arg5);
+  jresult = (jboolean)result; 
+  {
+    jstring jnewstring = NULL;
+    if (arg4) {
+      jnewstring = jenv->NewStringUTF(*arg4);
+    }
+    jenv->SetObjectArrayElement(jarg4, 0, jnewstring); 
+  }
+  SWIG_JavaArrayArgoutLong(jenv, jarr5, (long *)arg5, jarg5); 
+  delete [] arg5; 
+  return jresult;
+}
+
+
+SWIGEXPORT jboolean JNICALL Java_muargus_extern_dataengine_MuArgusCtrlJNI_CMuArgCtrl_1GetUnsafeCells(JNIEnv *jenv, jclass jcls, jlong jarg1, jobject jarg1_, jint jarg2, jint jarg3, jint jarg4, jint jarg5, jintArray jarg6, jintArray jarg7, jintArray jarg8, jdoubleArray jarg9, jintArray jarg10) {
+  jboolean jresult = 0 ;
+  CMuArgCtrl *arg1 = (CMuArgCtrl *) 0 ;
+  long arg2 ;
+  long arg3 ;
+  long arg4 ;
+  long arg5 ;
+  long *arg6 = (long *) 0 ;
+  long *arg7 = (long *) 0 ;
+  long *arg8 = (long *) 0 ;
+  double *arg9 = (double *) 0 ;
+  long *arg10 = (long *) 0 ;
+  long temp6 ;
+  jint *jarr7 ;
+  jint *jarr8 ;
+  jdouble *jarr9 ;
+  long temp10 ;
+  bool result;
+  
+  (void)jenv;
+  (void)jcls;
+  (void)jarg1_;
+  arg1 = *(CMuArgCtrl **)&jarg1; 
+  arg2 = (long)jarg2; 
+  arg3 = (long)jarg3; 
+  arg4 = (long)jarg4; 
+  arg5 = (long)jarg5; 
+  {
+    if (!jarg6) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaNullPointerException, "array null");
+      return 0;
+    }
+    if (jenv->GetArrayLength(jarg6) == 0) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaIndexOutOfBoundsException, "Array must contain at least 1 element");
+      return 0;
+    }
+    temp6 = (long)0;
+    arg6 = &temp6; 
+  }
+  if (!SWIG_JavaArrayInLong(jenv, &jarr7, (long **)&arg7, jarg7)) return 0; 
+  if (!SWIG_JavaArrayInLong(jenv, &jarr8, (long **)&arg8, jarg8)) return 0; 
+  if (!SWIG_JavaArrayInDouble(jenv, &jarr9, (double **)&arg9, jarg9)) return 0; 
+  {
+    if (!jarg10) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaNullPointerException, "array null");
+      return 0;
+    }
+    if (jenv->GetArrayLength(jarg10) == 0) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaIndexOutOfBoundsException, "Array must contain at least 1 element");
+      return 0;
+    }
+    temp10 = (long)0;
+    arg10 = &temp10; 
+  }
+  result = (bool)(arg1)->GetUnsafeCells(arg2,arg3,arg4,arg5,arg6,arg7,arg8,arg9,arg10);
+  jresult = (jboolean)result; 
+  {
+    jint jvalue = (jint)temp6;
+    jenv->SetIntArrayRegion(jarg6, 0, 1, &jvalue);
+  }
+  SWIG_JavaArrayArgoutLong(jenv, jarr7, (long *)arg7, jarg7); 
+  SWIG_JavaArrayArgoutLong(jenv, jarr8, (long *)arg8, jarg8); 
+  SWIG_JavaArrayArgoutDouble(jenv, jarr9, (double *)arg9, jarg9); 
+  {
+    jint jvalue = (jint)temp10;
+    jenv->SetIntArrayRegion(jarg10, 0, 1, &jvalue);
+  }
+  delete [] arg7; 
+  delete [] arg8; 
+  delete [] arg9; 
+  return jresult;
+}
+
+
+SWIGEXPORT jboolean JNICALL Java_muargus_extern_dataengine_MuArgusCtrlJNI_CMuArgCtrl_1EvaluateRecodes(JNIEnv *jenv, jclass jcls, jlong jarg1, jobject jarg1_, jint jarg2, jint jarg3, jobjectArray jarg4, jstring jarg5, jstring jarg6, jintArray jarg7, jintArray jarg8, jintArray jarg9, jintArray jarg10) {
+  jboolean jresult = 0 ;
+  CMuArgCtrl *arg1 = (CMuArgCtrl *) 0 ;
+  long arg2 ;
+  long arg3 ;
+  char **arg4 = (char **) 0 ;
+  char *arg5 = (char *) 0 ;
+  char *arg6 = (char *) 0 ;
+  long *arg7 = (long *) 0 ;
+  long *arg8 = (long *) 0 ;
+  long *arg9 = (long *) 0 ;
+  long *arg10 = (long *) 0 ;
+  jint size4 ;
+  jint *jarr7 ;
+  jint *jarr8 ;
+  long temp9 ;
+  jint *jarr10 ;
+  bool result;
+  
+  (void)jenv;
+  (void)jcls;
+  (void)jarg1_;
+  arg1 = *(CMuArgCtrl **)&jarg1; 
+  arg2 = (long)jarg2; 
+  arg3 = (long)jarg3; 
+  {
+    int i = 0;
+    if (jarg4) {
+      size4 = jenv->GetArrayLength(jarg4);
+      arg4 = new char*[size4+1];
+      
+      for (i = 0; i<size4; i++) {
+        jstring j_string = (jstring)jenv->GetObjectArrayElement(jarg4, i);
+        const char *c_string = jenv->GetStringUTFChars(j_string, 0);
+        arg4[i] = new char [strlen(c_string)+1];
+        strcpy(arg4[i], c_string);
+        jenv->ReleaseStringUTFChars(j_string, c_string);
+        jenv->DeleteLocalRef(j_string);
+      }
+      arg4[i] = 0;
+    } else {
+      arg4 = 0;
+      size4 = 0;
+    }
+  }
+  arg5 = 0;
+  if (jarg5) {
+    arg5 = (char *)jenv->GetStringUTFChars(jarg5, 0);
+    if (!arg5) return 0;
+  }
+  arg6 = 0;
+  if (jarg6) {
+    arg6 = (char *)jenv->GetStringUTFChars(jarg6, 0);
+    if (!arg6) return 0;
+  }
+  if (!SWIG_JavaArrayInLong(jenv, &jarr7, (long **)&arg7, jarg7)) return 0; 
+  if (!SWIG_JavaArrayInLong(jenv, &jarr8, (long **)&arg8, jarg8)) return 0; 
+  {
+    if (!jarg9) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaNullPointerException, "array null");
+      return 0;
+    }
+    if (jenv->GetArrayLength(jarg9) == 0) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaIndexOutOfBoundsException, "Array must contain at least 1 element");
+      return 0;
+    }
+    temp9 = (long)0;
+    arg9 = &temp9; 
+  }
+  if (!SWIG_JavaArrayInLong(jenv, &jarr10, (long **)&arg10, jarg10)) return 0; 
+  result = (bool)(arg1)->EvaluateRecodes(arg2,arg3,arg4,(char const *)arg5,(char const *)arg6,arg7,arg8,arg9,arg10);
+  jresult = (jboolean)result; 
+  SWIG_JavaArrayArgoutLong(jenv, jarr7, (long *)arg7, jarg7); 
+  SWIG_JavaArrayArgoutLong(jenv, jarr8, (long *)arg8, jarg8); 
+  {
+    jint jvalue = (jint)temp9;
+    jenv->SetIntArrayRegion(jarg9, 0, 1, &jvalue);
+  }
+  SWIG_JavaArrayArgoutLong(jenv, jarr10, (long *)arg10, jarg10); 
+  {
+    int i;
+    for (i=0; i<size4; i++)
+    delete[] arg4[i];
+    delete[] arg4;
+  }
+  if (arg5) jenv->ReleaseStringUTFChars(jarg5, (const char *)arg5);
+  if (arg6) jenv->ReleaseStringUTFChars(jarg6, (const char *)arg6);
+  delete [] arg7; 
+  delete [] arg8; 
+  delete [] arg10; 
+  return jresult;
+}
+
+
+SWIGEXPORT jboolean JNICALL Java_muargus_extern_dataengine_MuArgusCtrlJNI_CMuArgCtrl_1SearchRecode(JNIEnv *jenv, jclass jcls, jlong jarg1, jobject jarg1_, jint jarg2, jint jarg3, jint jarg4, jdouble jarg5, jintArray jarg6, jintArray jarg7, jdoubleArray jarg8, jobjectArray jarg9) {
+  jboolean jresult = 0 ;
+  CMuArgCtrl *arg1 = (CMuArgCtrl *) 0 ;
+  long arg2 ;
+  long arg3 ;
+  long arg4 ;
+  double arg5 ;
+  long *arg6 = (long *) 0 ;
+  long *arg7 = (long *) 0 ;
+  double *arg8 = (double *) 0 ;
+  char **arg9 = (char **) 0 ;
+  long temp6 ;
+  long temp7 ;
+  double temp8 ;
+  char *temp9 ;
+  bool result;
+  
+  (void)jenv;
+  (void)jcls;
+  (void)jarg1_;
+  arg1 = *(CMuArgCtrl **)&jarg1; 
+  arg2 = (long)jarg2; 
+  arg3 = (long)jarg3; 
+  arg4 = (long)jarg4; 
+  arg5 = (double)jarg5; 
+  {
+    if (!jarg6) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaNullPointerException, "array null");
+      return 0;
+    }
+    if (jenv->GetArrayLength(jarg6) == 0) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaIndexOutOfBoundsException, "Array must contain at least 1 element");
+      return 0;
+    }
+    temp6 = (long)0;
+    arg6 = &temp6; 
+  }
+  {
+    if (!jarg7) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaNullPointerException, "array null");
+      return 0;
+    }
+    if (jenv->GetArrayLength(jarg7) == 0) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaIndexOutOfBoundsException, "Array must contain at least 1 element");
+      return 0;
+    }
+    temp7 = (long)0;
+    arg7 = &temp7; 
+  }
+  {
+    if (!jarg8) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaNullPointerException, "array null");
+      return 0;
+    }
+    if (jenv->GetArrayLength(jarg8) == 0) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaIndexOutOfBoundsException, "Array must contain at least 1 element");
+      return 0;
+    }
+    temp8 = (double)0;
+    arg8 = &temp8; 
+  }
+  {
+    if (!jarg9) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaNullPointerException, "array null");
+      return 0;
+    }
+    if (jenv->GetArrayLength(jarg9) == 0) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaIndexOutOfBoundsException, "Array must contain at least 1 element");
+      return 0;
+    }
+    arg9 = &temp9; 
+    *arg9 = 0;
+  }
+  result = (bool)(arg1)->SearchRecode(arg2,arg3,arg4,arg5,arg6,arg7,arg8,(char const **)arg9);
+  jresult = (jboolean)result; 
+  {
+    jint jvalue = (jint)temp6;
+    jenv->SetIntArrayRegion(jarg6, 0, 1, &jvalue);
+  }
+  {
+    jint jvalue = (jint)temp7;
+    jenv->SetIntArrayRegion(jarg7, 0, 1, &jvalue);
+  }
+  {
+    jdouble jvalue = (jdouble)temp8;
+    jenv->SetDoubleArrayRegion(jarg8, 0, 1, &jvalue);
+  }
+  {
+    jstring jnewstring = NULL;
+    if (arg9) {
+      jnewstring = jenv->NewStringUTF(*arg9);
+    }
+    jenv->SetObjectArrayElement(jarg9, 0, jnewstring); 
+  }
+  
+  
+  
+  return jresult;
+}
+
+SWIGEXPORT jboolean JNICALL Java_muargus_extern_dataengine_MuArgusCtrlJNI_CMuArgCtrl_1SearchTruncate(JNIEnv *jenv, jclass jcls, jlong jarg1, jobject jarg1_, jint jarg2, jdouble jarg3, jintArray jarg4, jintArray jarg5, jdoubleArray jarg6) {
+  jboolean jresult = 0 ;
+  CMuArgCtrl *arg1 = (CMuArgCtrl *) 0 ;
+  long arg2 ;
+  double arg3 ;
+  long *arg4 = (long *) 0 ;
+  long *arg5 = (long *) 0 ;
+  double *arg6 = (double *) 0 ;
+  long temp4 ;
+  long temp5 ;
+  double temp6 ;
+  bool result;
+  
+  (void)jenv;
+  (void)jcls;
+  (void)jarg1_;
+  arg1 = *(CMuArgCtrl **)&jarg1; 
+  arg2 = (long)jarg2; 
+  arg3 = (double)jarg3; 
+  {
+    if (!jarg4) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaNullPointerException, "array null");
+      return 0;
+    }
+    if (jenv->GetArrayLength(jarg4) == 0) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaIndexOutOfBoundsException, "Array must contain at least 1 element");
+      return 0;
+    }
+    temp4 = (long)0;
+    arg4 = &temp4; 
+  }
+  {
+    if (!jarg5) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaNullPointerException, "array null");
+      return 0;
+    }
+    if (jenv->GetArrayLength(jarg5) == 0) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaIndexOutOfBoundsException, "Array must contain at least 1 element");
+      return 0;
+    }
+    temp5 = (long)0;
+    arg5 = &temp5; 
+  }
+  {
+    if (!jarg6) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaNullPointerException, "array null");
+      return 0;
+    }
+    if (jenv->GetArrayLength(jarg6) == 0) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaIndexOutOfBoundsException, "Array must contain at least 1 element");
+      return 0;
+    }
+    temp6 = (double)0;
+    arg6 = &temp6; 
+  }
+  result = (bool)(arg1)->SearchTruncate(arg2,arg3,arg4,arg5,arg6);
+  jresult = (jboolean)result; 
+  {
+    jint jvalue = (jint)temp4;
+    jenv->SetIntArrayRegion(jarg4, 0, 1, &jvalue);
+  }
+  {
+    jint jvalue = (jint)temp5;
+    jenv->SetIntArrayRegion(jarg5, 0, 1, &jvalue);
+  }
+  {
+    jdouble jvalue = (jdouble)temp6;
+    jenv->SetDoubleArrayRegion(jarg6, 0, 1, &jvalue);
+  }
+  
+  
+  
+  return jresult;
+}
+
+SWIGEXPORT jboolean JNICALL Java_muargus_extern_dataengine_MuArgusCtrlJNI_CMuArgCtrl_1SetHierarchyPrefix(JNIEnv *jenv, jclass jcls, jlong jarg1, jobject jarg1_, jint jarg2, jint jarg3, jintArray jarg4) {
+  jboolean jresult = 0 ;
+  CMuArgCtrl *arg1 = (CMuArgCtrl *) 0 ;
+  long arg2 ;
+  long arg3 ;
+  long *arg4 = (long *) 0 ;
+  jint *jarr4 ;
+  bool result;
+  
+  (void)jenv;
+  (void)jcls;
+  (void)jarg1_;
+  arg1 = *(CMuArgCtrl **)&jarg1; 
+  arg2 = (long)jarg2; 
+  arg3 = (long)jarg3; 
+  if (!SWIG_JavaArrayInLong(jenv, &jarr4, (long **)&arg4, jarg4)) return 0; 
+  result = (bool)(arg1)->SetHierarchyPrefix(arg2,arg3,arg4);
+  jresult = (jboolean)result; 
+  SWIG_JavaArrayArgoutLong(jenv, jarr4, (long *)arg4, jarg4); 
+  delete [] arg4; 
+  return jresult;
+}
+
+SWIGEXPORT jboolean JNICALL Java_muargus_extern_dataengine_MuArgusCtrlJNI_CMuArgCtrl_1AddHierarchyLevel(JNIEnv *jenv, jclass jcls, jlong jarg1, jobject jarg1_, jint jarg2, jstring jarg3, jintArray jarg4, jintArray jarg5, jintArray jarg6) {
+  jboolean jresult = 0 ;
+  CMuArgCtrl *arg1 = (CMuArgCtrl *) 0 ;
+  long arg2 ;
+  char *arg3 = (char *) 0 ;
+  long *arg4 = (long *) 0 ;
+  long *arg5 = (long *) 0 ;
+  long *arg6 = (long *) 0 ;
+  long temp4 ;
+  long temp5 ;
+  long temp6 ;
+  bool result;
+  
+  (void)jenv;
+  (void)jcls;
+  (void)jarg1_;
+  arg1 = *(CMuArgCtrl **)&jarg1; 
+  arg2 = (long)jarg2; 
+  arg3 = 0;
+  if (jarg3) {
+    arg3 = (char *)jenv->GetStringUTFChars(jarg3, 0);
+    if (!arg3) return 0;
+  }
+  {
+    if (!jarg4) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaNullPointerException, "array null");
+      return 0;
+    }
+    if (jenv->GetArrayLength(jarg4) == 0) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaIndexOutOfBoundsException, "Array must contain at least 1 element");
+      return 0;
+    }
+    temp4 = (long)0;
+    arg4 = &temp4; 
+  }
+  {
+    if (!jarg5) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaNullPointerException, "array null");
+      return 0;
+    }
+    if (jenv->GetArrayLength(jarg5) == 0) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaIndexOutOfBoundsException, "Array must contain at least 1 element");
+      return 0;
+    }
+    temp5 = (long)0;
+    arg5 = &temp5; 
+  }
+  {
+    if (!jarg6) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaNullPointerException, "array null");
+      return 0;
+    }
+    if (jenv->GetArrayLength(jarg6) == 0) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaIndexOutOfBoundsException, "Array must contain at least 1 element");
+      return 0;
+    }
+    temp6 = (long)0;
+    arg6 = &temp6; 
+  }
+  result = (bool)(arg1)->AddHierarchyLevel(arg2,(char const *)arg3,arg4,arg5,arg6);
+  jresult = (jboolean)result; 
+  {
+    jint jvalue = (jint)temp4;
+    jenv->SetIntArrayRegion(jarg4, 0, 1, &jvalue);
+  }
+  {
+    jint jvalue = (jint)temp5;
+    jenv->SetIntArrayRegion(jarg5, 0, 1, &jvalue);
+  }
+  {
+    jint jvalue = (jint)temp6;
+    jenv->SetIntArrayRegion(jarg6, 0, 1, &jvalue);
+  }
+  if (arg3) jenv->ReleaseStringUTFChars(jarg3, (const char *)arg3);
+  
+  
+  
+  return jresult;
+}
+
+SWIGEXPORT jboolean JNICALL Java_muargus_extern_dataengine_MuArgusCtrlJNI_CMuArgCtrl_1ClearHierarchy(JNIEnv *jenv, jclass jcls, jlong jarg1, jobject jarg1_, jint jarg2) {
+  jboolean jresult = 0 ;
+  CMuArgCtrl *arg1 = (CMuArgCtrl *) 0 ;
+  long arg2 ;
+  bool result;
+  
+  (void)jenv;
+  (void)jcls;
+  (void)jarg1_;
+  arg1 = *(CMuArgCtrl **)&jarg1; 
+  arg2 = (long)jarg2; 
+  result = (bool)(arg1)->ClearHierarchy(arg2);
+  jresult = (jboolean)result; 
+  return jresult;
+}
+
+SWIGEXPORT jboolean JNICALL Java_muargus_extern_dataengine_MuArgusCtrlJNI_CMuArgCtrl_1DoHierarchyLevel(JNIEnv *jenv, jclass jcls, jlong jarg1, jobject jarg1_, jint jarg2, jint jarg3) {
+  jboolean jresult = 0 ;
+  CMuArgCtrl *arg1 = (CMuArgCtrl *) 0 ;
+  long arg2 ;
+  long arg3 ;
+  bool result;
+  
+  (void)jenv;
+  (void)jcls;
+  (void)jarg1_;
+  arg1 = *(CMuArgCtrl **)&jarg1; 
+  arg2 = (long)jarg2; 
+  arg3 = (long)jarg3; 
+  result = (bool)(arg1)->DoHierarchyLevel(arg2,arg3);
+  jresult = (jboolean)result; 
+  return jresult;
+}
+
+SWIGEXPORT jboolean JNICALL Java_muargus_extern_dataengine_MuArgusCtrlJNI_CMuArgCtrl_1FindBIRThreshold(JNIEnv *jenv, jclass jcls, jlong jarg1, jobject jarg1_, jint jarg2, jint jarg3, jdoubleArray jarg4, jintArray jarg5) {
+  jboolean jresult = 0 ;
+  CMuArgCtrl *arg1 = (CMuArgCtrl *) 0 ;
+  long arg2 ;
+  long arg3 ;
+  double *arg4 = (double *) 0 ;
+  long *arg5 = (long *) 0 ;
+  double temp4 ;
+  long temp5 ;
+  bool result;
+  
+  (void)jenv;
+  (void)jcls;
+  (void)jarg1_;
+  arg1 = *(CMuArgCtrl **)&jarg1; 
+  arg2 = (long)jarg2; 
+  arg3 = (long)jarg3; 
+  {
+    if (!jarg4) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaNullPointerException, "array null");
+      return 0;
+    }
+    if (jenv->GetArrayLength(jarg4) == 0) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaIndexOutOfBoundsException, "Array must contain at least 1 element");
+      return 0;
+    }
+    temp4 = (double)0;
+    arg4 = &temp4; 
+  }
+  {
+    if (!jarg5) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaNullPointerException, "array null");
+      return 0;
+    }
+    if (jenv->GetArrayLength(jarg5) == 0) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaIndexOutOfBoundsException, "Array must contain at least 1 element");
+      return 0;
+    }
+    temp5 = (long)0;
+    arg5 = &temp5; 
+  }
+  result = (bool)(arg1)->FindBIRThreshold(arg2,arg3,arg4,arg5);
+  jresult = (jboolean)result; 
+  {
+    jdouble jvalue = (jdouble)temp4;
+    jenv->SetDoubleArrayRegion(jarg4, 0, 1, &jvalue);
+  }
+  {
+    jint jvalue = (jint)temp5;
+    jenv->SetIntArrayRegion(jarg5, 0, 1, &jvalue);
+  }
+  
+  
+  return jresult;
+}
+
+
+
+SWIGEXPORT jboolean JNICALL Java_muargus_extern_dataengine_MuArgusCtrlJNI_CMuArgCtrl_1FindBIRMaxRisk(JNIEnv *jenv, jclass jcls, jlong jarg1, jobject jarg1_, jint jarg2, jdouble jarg3, jdoubleArray jarg4) {
+  jboolean jresult = 0 ;
+  CMuArgCtrl *arg1 = (CMuArgCtrl *) 0 ;
+  long arg2 ;
+  double arg3 ;
+  double *arg4 = (double *) 0 ;
+  double temp4 ;
+  bool result;
+  
+  (void)jenv;
+  (void)jcls;
+  (void)jarg1_;
+  arg1 = *(CMuArgCtrl **)&jarg1; 
+  arg2 = (long)jarg2; 
+  arg3 = (double)jarg3; 
+  {
+    if (!jarg4) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaNullPointerException, "array null");
+      return 0;
+    }
+    if (jenv->GetArrayLength(jarg4) == 0) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaIndexOutOfBoundsException, "Array must contain at least 1 element");
+      return 0;
+    }
+    temp4 = (double)0;
+    arg4 = &temp4; 
+  }
+  result = (bool)(arg1)->FindBIRMaxRisk(arg2,arg3,arg4);
+  jresult = (jboolean)result; 
+  {
+    jdouble jvalue = (jdouble)temp4;
+    jenv->SetDoubleArrayRegion(jarg4, 0, 1, &jvalue);
+  }
+  
+  return jresult;
+}
+
+SWIGEXPORT jboolean JNICALL Java_muargus_extern_dataengine_MuArgusCtrlJNI_CMuArgCtrl_1ComputeBIRUnsafeCurve(JNIEnv *jenv, jclass jcls, jlong jarg1, jobject jarg1_, jint jarg2, jint jarg3, jdoubleArray jarg4, jintArray jarg5) {
+  jboolean jresult = 0 ;
+  CMuArgCtrl *arg1 = (CMuArgCtrl *) 0 ;
+  long arg2 ;
+  long arg3 ;
+  double *arg4 = (double *) 0 ;
+  long *arg5 = (long *) 0 ;
+  jdouble *jarr4 ;
+  jint *jarr5 ;
+  bool result;
+  
+  (void)jenv;
+  (void)jcls;
+  (void)jarg1_;
+  arg1 = *(CMuArgCtrl **)&jarg1; 
+  arg2 = (long)jarg2; 
+  arg3 = (long)jarg3; 
+  if (!SWIG_JavaArrayInDouble(jenv, &jarr4, (double **)&arg4, jarg4)) return 0; 
+  if (!SWIG_JavaArrayInLong(jenv, &jarr5, (long **)&arg5, jarg5)) return 0; 
+  result = (bool)(arg1)->ComputeBIRUnsafeCurve(arg2,arg3,arg4,arg5);
+  jresult = (jboolean)result; 
+  SWIG_JavaArrayArgoutDouble(jenv, jarr4, (double *)arg4, jarg4); 
+  SWIG_JavaArrayArgoutLong(jenv, jarr5, (long *)arg5, jarg5); 
+  delete [] arg4; 
+  delete [] arg5; 
+  return jresult;
+}
+
+
+
+SWIGEXPORT jboolean JNICALL Java_muargus_extern_dataengine_MuArgusCtrlJNI_CMuArgCtrl_1ComputeBIRRateCurve(JNIEnv *jenv, jclass jcls, jlong jarg1, jobject jarg1_, jint jarg2, jint jarg3, jdoubleArray jarg4, jdoubleArray jarg5) {
+  jboolean jresult = 0 ;
+  CMuArgCtrl *arg1 = (CMuArgCtrl *) 0 ;
+  long arg2 ;
+  long arg3 ;
+  double *arg4 = (double *) 0 ;
+  double *arg5 = (double *) 0 ;
+  jdouble *jarr4 ;
+  jdouble *jarr5 ;
+  bool result;
+  
+  (void)jenv;
+  (void)jcls;
+  (void)jarg1_;
+  arg1 = *(CMuArgCtrl **)&jarg1; 
+  arg2 = (long)jarg2; 
+  arg3 = (long)jarg3; 
+  if (!SWIG_JavaArrayInDouble(jenv, &jarr4, (double **)&arg4, jarg4)) return 0; 
+  if (!SWIG_JavaArrayInDouble(jenv, &jarr5, (double **)&arg5, jarg5)) return 0; 
+  result = (bool)(arg1)->ComputeBIRRateCurve(arg2,arg3,arg4,arg5);
+  jresult = (jboolean)result; 
+  SWIG_JavaArrayArgoutDouble(jenv, jarr4, (double *)arg4, jarg4); 
+  SWIG_JavaArrayArgoutDouble(jenv, jarr5, (double *)arg5, jarg5); 
+  delete [] arg4; 
+  delete [] arg5; 
+  return jresult;
+}
+
+
+
+SWIGEXPORT jboolean JNICALL Java_muargus_extern_dataengine_MuArgusCtrlJNI_CMuArgCtrl_1ComputeBHRUnsafeCurve(JNIEnv *jenv, jclass jcls, jlong jarg1, jobject jarg1_, jint jarg2, jint jarg3, jdoubleArray jarg4, jintArray jarg5, jintArray jarg6) {
+  jboolean jresult = 0 ;
+  CMuArgCtrl *arg1 = (CMuArgCtrl *) 0 ;
+  long arg2 ;
+  long arg3 ;
+  double *arg4 = (double *) 0 ;
+  long *arg5 = (long *) 0 ;
+  long *arg6 = (long *) 0 ;
+  jdouble *jarr4 ;
+  jint *jarr5 ;
+  jint *jarr6 ;
+  bool result;
+  
+  (void)jenv;
+  (void)jcls;
+  (void)jarg1_;
+  arg1 = *(CMuArgCtrl **)&jarg1; 
+  arg2 = (long)jarg2; 
+  arg3 = (long)jarg3; 
+  if (!SWIG_JavaArrayInDouble(jenv, &jarr4, (double **)&arg4, jarg4)) return 0; 
+  if (!SWIG_JavaArrayInLong(jenv, &jarr5, (long **)&arg5, jarg5)) return 0; 
+  if (!SWIG_JavaArrayInLong(jenv, &jarr6, (long **)&arg6, jarg6)) return 0; 
+  result = (bool)(arg1)->ComputeBHRUnsafeCurve(arg2,arg3,arg4,arg5,arg6);
+  jresult = (jboolean)result; 
+  SWIG_JavaArrayArgoutDouble(jenv, jarr4, (double *)arg4, jarg4); 
+  SWIG_JavaArrayArgoutLong(jenv, jarr5, (long *)arg5, jarg5); 
+  SWIG_JavaArrayArgoutLong(jenv, jarr6, (long *)arg6, jarg6); 
+  delete [] arg4; 
+  delete [] arg5; 
+  delete [] arg6; 
+  return jresult;
+}
+
+SWIGEXPORT jboolean JNICALL Java_muargus_extern_dataengine_MuArgusCtrlJNI_CMuArgCtrl_1FindBHRThreshold(JNIEnv *jenv, jclass jcls, jlong jarg1, jobject jarg1_, jint jarg2, jboolean jarg3, jint jarg4, jdoubleArray jarg5, jintArray jarg6, jintArray jarg7) {
+  jboolean jresult = 0 ;
+  CMuArgCtrl *arg1 = (CMuArgCtrl *) 0 ;
+  long arg2 ;
+  bool arg3 ;
+  long arg4 ;
+  double *arg5 = (double *) 0 ;
+  long *arg6 = (long *) 0 ;
+  long *arg7 = (long *) 0 ;
+  double temp5 ;
+  long temp6 ;
+  long temp7 ;
+  bool result;
+  
+  (void)jenv;
+  (void)jcls;
+  (void)jarg1_;
+  arg1 = *(CMuArgCtrl **)&jarg1; 
+  arg2 = (long)jarg2; 
+  arg3 = jarg3 ? true : false; 
+  arg4 = (long)jarg4; 
+  {
+    if (!jarg5) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaNullPointerException, "array null");
+      return 0;
+    }
+    if (jenv->GetArrayLength(jarg5) == 0) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaIndexOutOfBoundsException, "Array must contain at least 1 element");
+      return 0;
+    }
+    temp5 = (double)0;
+    arg5 = &temp5; 
+  }
+  {
+    if (!jarg6) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaNullPointerException, "array null");
+      return 0;
+    }
+    if (jenv->GetArrayLength(jarg6) == 0) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaIndexOutOfBoundsException, "Array must contain at least 1 element");
+      return 0;
+    }
+    temp6 = (long)0;
+    arg6 = &temp6; 
+  }
+  {
+    if (!jarg7) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaNullPointerException, "array null");
+      return 0;
+    }
+    if (jenv->GetArrayLength(jarg7) == 0) {
+      SWIG_JavaThrowException(jenv, SWIG_JavaIndexOutOfBoundsException, "Array must contain at least 1 element");
+      return 0;
+    }
+    temp7 = (long)0;
+    arg7 = &temp7; 
+  }
+  result = (bool)(arg1)->FindBHRThreshold(arg2,arg3,arg4,arg5,arg6,arg7);
+  jresult = (jboolean)result; 
+  {
+    jdouble jvalue = (jdouble)temp5;
+    jenv->SetDoubleArrayRegion(jarg5, 0, 1, &jvalue);
+  }
+  {
+    jint jvalue = (jint)temp6;
+    jenv->SetIntArrayRegion(jarg6, 0, 1, &jvalue);
+  }
+  {
+    jint jvalue = (jint)temp7;
+    jenv->SetIntArrayRegion(jarg7, 0, 1, &jvalue);
+  }
+  
+  
+  
+  return jresult;
+}
+
+
+SWIGEXPORT jboolean JNICALL Java_muargus_extern_dataengine_MuArgusCtrlJNI_CMuArgCtrl_1SetHouseholdGrouping(JNIEnv *jenv, jclass jcls, jlong jarg1, jobject jarg1_, jstring jarg2, jboolean jarg3) {
+  jboolean jresult = 0 ;
+  CMuArgCtrl *arg1 = (CMuArgCtrl *) 0 ;
+  std::string arg2 ;
+  bool arg3 ;
+  bool result;
+  
+  (void)jenv;
+  (void)jcls;
+  (void)jarg1_;
+  arg1 = *(CMuArgCtrl **)&jarg1; 
+  if(!jarg2) {
+    SWIG_JavaThrowException(jenv, SWIG_JavaNullPointerException, "null string");
+    return 0;
+  } 
+  const char *arg2_pstr = (const char *)jenv->GetStringUTFChars(jarg2, 0); 
+  if (!arg2_pstr) return 0;
+  (&arg2)->assign(arg2_pstr);
+  jenv->ReleaseStringUTFChars(jarg2, arg2_pstr); 
+  arg3 = jarg3 ? true : false; 
+  result = (bool)(arg1)->SetHouseholdGrouping(arg2,arg3);
+  jresult = (jboolean)result; 
+  return jresult;
+}
+
+
 SWIGEXPORT void JNICALL Java_muargus_extern_dataengine_MuArgusCtrlJNI_swig_1module_1init(JNIEnv *jenv, jclass jcls) {
   int i;
   
@@ -18,6 +18,10 @@
 # if ! defined Recode_h
 # define Recode_h
 
+#include "Table.h"
+#include <vector>
+#include <algorithm>
+
 class CRecode
 {
 public:
@@ -30,4 +34,75 @@ public:
 	int CodeWidth;          // all sCodes have this width
 };
 
+// an entry of UCList kept for a combination of recode versions
+class CUCListState
+{
+public:
+	int Index;              // index in UCList
+	CTable table;           // content of subtable, no cells for a base table
+	int nUC;
+	int MinFreq;
+	bool Pruned;
+};
+
+// the recoded table of a base table for a combination of recode versions,
+// with the entries of UCList computed for it. Kept for undo/redo, see ApplyRecode
+class CRecodedTables
+{
+public:
+	CRecodedTables()
+	{
+            Used = false;
+            LastUsed = 0;
+	}
+	int Version[MAXDIM];    // per dimension the recode version of the variable, 0 if not recoded
+	CTable table;           // the recoded table, no cells if no variable is recoded
+	std::vector<CUCListState> UC;  // in order of Index
+	long LastUsed;          // for removing the least recently used one
+	bool Used;
+};
+
+// a base table with the codes of a variable at a level of its hierarchy, see DoHierarchyLevel
+class CLevelTable
+{
+public:
+	int TabNr;              // index of base table
+	int Dim;                // dimension of the variable
+	int Level;              // level of the hierarchy
+	CTable table;
+};
+
+// a (sub)table of UCList with the variable of SearchRecode:
+// per code of the variable the cells with no missing code of the other variables
+class CRecodeSearchTable
+{
+public:
+	long Threshold;
+	long nRest;             // number of cells per code
+	std::vector<long> Cell; // nRest cells of code 0, then of code 1, ...
+};
+
+// a grouping of adjacent codes of a variable, see SearchRecode
+class CRecodeSearchState
+{
+public:
+	std::vector<int> First;                 // first code of every group
+	std::vector<double> Freq;               // frequency of every group
+	std::vector< std::vector<long> > Cell;  // per CRecodeSearchTable the cells of every group
+	std::vector< std::vector<long> > UC;    // per CRecodeSearchTable the number of unsafe cells of every group
+	long nUnsafe;
+	double Loss;            // entropy loss in bits
+	double Cost;            // nUnsafe + weighted Loss
+	void Swap(CRecodeSearchState &s)
+	{
+            First.swap(s.First);
+            Freq.swap(s.Freq);
+            Cell.swap(s.Cell);
+            UC.swap(s.UC);
+            std::swap(nUnsafe, s.nUnsafe);
+            std::swap(Loss, s.Loss);
+            std::swap(Cost, s.Cost);
+	}
+};
+
 #endif
@@ -19,6 +19,7 @@
 #define Table_h
 
 #include "globals.h"
+#include <vector>
 
 class CTable {
 public:
@@ -83,4 +84,39 @@ public:
 
 };
 
+// per cell of a BIR (sub)table the frequency and weight with the corresponding
+// missings added (see AddMissing) and the individual risk, see FindBIRCells
+class CBIRCells
+{
+public:
+	CBIRCells()
+	{
+            Cell = 0;
+            Sorted = false;
+	}
+	const long *Cell;       // cells of the table, identifies it
+	std::vector<long> Freq;
+	std::vector<double> Weight;
+	std::vector<double> Risk;
+	std::vector<char> State; // BIRCELL_NONE, ...
+
+	// the cells with a risk sorted on it, with prefix sums, see FindBIRIndex
+	bool Sorted;
+	std::vector<double> SortRisk;     // ascending
+	std::vector<double> SortLogRisk;
+	std::vector<long> SortFreq;       // frequency with the missings added
+	std::vector<long> CumCell;        // sum of the cell frequencies of the first i cells
+	std::vector<long> CumFreq;        // sum of SortFreq of the first i cells
+	std::vector<double> CumFreqRisk;  // sum of SortFreq * SortRisk of the first i cells
+};
+
+// the households sorted on their BHR for a BIR table, see FindBHRIndex
+class CBHRIndex
+{
+public:
+	std::vector<double> SortBHR;      // ascending
+	std::vector<double> SortLogBHR;   // log of SortBHR
+	std::vector<long> CumRec;         // number of members of the first i households
+};
+
 #endif
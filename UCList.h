@@ -34,8 +34,9 @@ public:
             Threshold = 0;
             nUC = 0;
             biggestThreshold = 0;
-            unsafe = 0;
             HasPram = 0;
+            MinFreq = 0;
+            Pruned = false;
             //table =0;
 	}
 	~CUCList()
@@ -50,8 +51,18 @@ public:
 	int biggestThreshold;   // combination of variables with biggest threshold (true/false)
 	CTable table;           // content of subtable
 
-	bool unsafe;            // during MakeFileSave: combination of variables is unsafe?
         bool HasPram;           // true: at least one of the variables of the table is prammed
+        int MinFreq;            // lower bound of the smallest non-zero cell (missings included)
+        bool Pruned;            // true: safe, a superset table has no non-zero cell <= Threshold
+};
+
+// compact sort key of a CUCList, so the list can be sorted without copying tables
+class CUCKey
+{
+public:
+	int Varnr[MAXDIM];      // variable indices, unused ones 0
+	int Threshold;          // threshold of the table
+	int Index;              // index in UCList
 };
 
 #endif
@@ -18,6 +18,7 @@
 #include "Variable.h"
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
 #include <algorithm>
 
 bool CVariable::SetPosition(long lbPos, long lnPos, long lnDec)
@@ -232,12 +233,10 @@ void CVariable::QuickSortStringArray(std::vector<std::string> &s, int first, int
 bool CVariable::SetTableIndex(std::string scode)
 {
     bool IsMissing;
-    TableIndex = BinSearchStringArray(scode, IsMissing);
+    TableIndex = FindTableIndex(scode, IsMissing);
     TableIsMissing = IsMissing;
 
-    // in case of a recode, take the recode index
     if (HasRecode) {
-        TableIndex = Recode.DestCode[TableIndex];
         assert(TableIndex >= 0);
         if (TableIndex < 0) {
             return false;   // program error
@@ -247,6 +246,19 @@ bool CVariable::SetTableIndex(std::string scode)
     return true;
 }
 
+// the (recode) index of code scode without changing the variable, -1 if not found
+int CVariable::FindTableIndex(std::string scode, bool& IsMissing)
+{
+    int Index = BinSearchStringArray(scode, IsMissing);
+
+    // in case of a recode, take the recode index
+    if (HasRecode && Index >= 0) {
+        Index = Recode.DestCode[Index];
+    }
+
+    return Index;
+}
+
 void CVariable::AddSpacesBefore(std::string& str, int len)
 { int width = str.length();
 
@@ -345,6 +357,7 @@ void CVariable::UndoRecode()
 		}
 	}
 	HasRecode = false;
+	HierarchyLevel = 0;
 }
 
 bool CVariable::PrepareRecode()
@@ -557,3 +570,146 @@ double CVariable::DoWeightNoise(double val)
 
 }
 
+// index in RecodeCache of the recode with this specification, -1 if not there
+int CVariable::FindRecodeVersion(const std::string &Spec)
+{
+	for (int k = 0; k < (int) RecodeCache.size(); k++) {
+		if (RecodeCache[k].Spec == Spec) {
+			return k;
+		}
+	}
+	return -1;
+}
+
+// makes version k of RecodeCache the current recode, HasRecode is left to the caller
+bool CVariable::UseRecodeVersion(int k, std::string &Warning)
+{
+	RECODEVERSION *r = &(RecodeCache[k]);
+
+	if (Recode.DestCode != 0) {
+		free(Recode.DestCode);
+	}
+	Recode = r->Recode;
+	Recode.DestCode = (int *) malloc(nCode * sizeof(int));
+	if (Recode.DestCode == 0) {
+		return false;
+	}
+	memcpy(Recode.DestCode, r->Recode.DestCode, nCode * sizeof(int));
+
+	RecodeVersion = r->Version;
+	r->LastUsed = ++RecodeClock;
+	Warning = r->Warning;
+	return true;
+}
+
+// keeps the current recode as a new version, the least recently used one is removed if needed
+bool CVariable::AddRecodeVersion(const std::string &Spec, const std::string &Warning)
+{
+	int k, oldest = 0;
+	RECODEVERSION r;
+
+	r.Spec = Spec;
+	r.Version = ++nRecodeVersions;
+	r.LastUsed = ++RecodeClock;
+	r.Recode = Recode;
+	r.Warning = Warning;
+	r.Recode.DestCode = (int *) malloc(nCode * sizeof(int));
+	if (r.Recode.DestCode == 0) {
+		RecodeVersion = r.Version;  // not kept, but a new version
+		return false;
+	}
+	memcpy(r.Recode.DestCode, Recode.DestCode, nCode * sizeof(int));
+
+	if (RecodeCache.size() >= RECODECACHESIZE) {
+		for (k = 1; k < (int) RecodeCache.size(); k++) {
+			if (RecodeCache[k].LastUsed < RecodeCache[oldest].LastUsed) {
+				oldest = k;
+			}
+		}
+		free(RecodeCache[oldest].Recode.DestCode);
+		RecodeCache.erase(RecodeCache.begin() + oldest);
+	}
+	RecodeCache.push_back(r);
+	RecodeVersion = r.Version;
+	return true;
+}
+
+void CVariable::ClearRecodeCache()
+{
+	for (int k = 0; k < (int) RecodeCache.size(); k++) {
+		free(RecodeCache[k].Recode.DestCode);
+	}
+	RecodeCache.clear();
+}
+
+// does Recode group the codes of the last level of the hierarchy?
+bool CVariable::GroupsHierarchyLevel()
+{
+	if (Hierarchy.empty()) {
+		return true;
+	}
+
+	RECODE *prev = &(Hierarchy.back());
+	std::vector<int> parent(prev->nCode, -1);
+	for (int c = 0; c < nCode; c++) {
+		int p = prev->DestCode[c];
+		if (parent[p] < 0) {
+			parent[p] = Recode.DestCode[c];
+		}
+		else if (parent[p] != Recode.DestCode[c]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// adds a copy of the current recode as the next level of the hierarchy
+bool CVariable::AddHierarchyRecode()
+{
+	RECODE r = Recode;
+
+	r.DestCode = (int *) malloc(nCode * sizeof(int));
+	if (r.DestCode == 0) {
+		return false;
+	}
+	memcpy(r.DestCode, Recode.DestCode, nCode * sizeof(int));
+	Hierarchy.push_back(r);
+	return true;
+}
+
+// makes level Level of the hierarchy the current recode, HasRecode is left to the caller
+bool CVariable::UseHierarchyLevel(int Level)
+{
+	RECODE *r = &(Hierarchy[Level - 1]);
+
+	if (Recode.DestCode != 0) {
+		free(Recode.DestCode);
+	}
+	Recode = *r;
+	Recode.DestCode = (int *) malloc(nCode * sizeof(int));
+	if (Recode.DestCode == 0) {
+		return false;
+	}
+	memcpy(Recode.DestCode, r->DestCode, nCode * sizeof(int));
+	HierarchyLevel = Level;
+	return true;
+}
+
+void CVariable::ClearHierarchy()
+{
+	int k;
+
+	for (k = 0; k < (int) Hierarchy.size(); k++) {
+		free(Hierarchy[k].DestCode);
+	}
+	Hierarchy.clear();
+	HierarchyLevel = 0;
+
+	// the kept versions of the levels are of no use anymore
+	for (k = RecodeCache.size() - 1; k >= 0; k--) {
+		if (RecodeCache[k].Spec[0] == 'H') {
+			free(RecodeCache[k].Recode.DestCode);
+			RecodeCache.erase(RecodeCache.begin() + k);
+		}
+	}
+}
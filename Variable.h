@@ -40,6 +40,28 @@ typedef struct {
 
 } RECODE;
 
+typedef struct {
+	std::string DestCode;   // destination code as specified
+	std::string SrcCode1;   // source code(s), spaces before up to the width of the variable
+	std::string SrcCode2;
+	int fromto;             // FROMTO_TO, FROMTO_SOLO, FROMTO_FROM or FROMTO_RANGE
+	int Line;               // line and position in the recode string, for errors
+	int Pos;
+	int First;              // index of first and last source code, computed once
+	int Last;
+	int Status;             // 0 if oke, R_CODENOTINLIST, R_NOSENSE or R_MISSING2VALID
+
+} RECODERULE;
+
+typedef struct {
+	std::string Spec;       // normalized recode specification, see DoRecode and DoTruncate
+	int Version;            // number of this version of the recode, > 0
+	long LastUsed;          // for removing the least recently used one
+	RECODE Recode;          // the recode, DestCode is a copy owned by the cache
+	std::string Warning;    // warning of DoRecode
+
+} RECODEVERSION;
+
 class CVariable {
 
 public:
@@ -65,6 +87,10 @@ public:
 		Entropy = -1;
 		PramBandWidth = -1;
 		RelatedTo = -1;
+		RecodeVersion = 0;
+		nRecodeVersions = 0;
+		RecodeClock = 0;
+		HierarchyLevel = 0;
 
 	}
 	~CVariable()
@@ -78,6 +104,8 @@ public:
 				Recode.DestCode = 0;
 			}
 		}
+		ClearRecodeCache();
+		ClearHierarchy();
 
 	}
 	long bPos;
@@ -104,10 +132,15 @@ public:
 
 	bool HasRecode;
 	RECODE Recode;
+	int RecodeVersion;      // version of the recode in Recode, 0 if none
+	int nRecodeVersions;    // number of versions made
+	long RecodeClock;       // counts the use of versions
+	std::vector<RECODEVERSION> RecodeCache; // recently used recodes, to apply them again without parsing
+	std::vector<RECODE> Hierarchy;  // code hierarchy: per level 1, 2, ... the recode to the codes of that level
+	int HierarchyLevel;     // level of the hierarchy in Recode, 0 if none
 	/// Some more stuff comes here
 	int TableIndex;         // index in table (temporarely used during tabulation and MakeSafe)
 	bool TableIsMissing;    // index is Missing
-        int freq;               // frequency in unsafe tables
         int nSuppress;          // counts suppresses
 
 	int Priority;           // to make the choice easier by set missings, value 0 - 100?
@@ -143,6 +176,7 @@ public:
 	int    BinSearchStringArray(std::vector<std::string> &s, std::string x, int nMissing, bool &IsMissing);
 	void   SortCodeLists();
 	bool   SetTableIndex(std::string scode); 
+	int    FindTableIndex(std::string scode, bool& IsMissing);
 	int    GetnCodes(bool WithMissing);
 	void   UndoRecode();
 	bool   PrepareRecode();
@@ -155,6 +189,14 @@ public:
 	long   ComputeWidth(long nPos, long HHIdentOption, long nRecords);
 	double DoRound(double val);
 	double DoWeightNoise(double val);
+	int    FindRecodeVersion(const std::string &Spec);
+	bool   UseRecodeVersion(int k, std::string &Warning);
+	bool   AddRecodeVersion(const std::string &Spec, const std::string &Warning);
+	void   ClearRecodeCache();
+	bool   GroupsHierarchyLevel();
+	bool   AddHierarchyRecode();
+	bool   UseHierarchyLevel(int Level);
+	void   ClearHierarchy();
 	
 private:
 	void QuickSortStringArray(std::vector<std::string> &s, int first, int last);
@@ -29,14 +29,21 @@
 
 #define FIREPROGRESS 1000
 
+#define PARALLELMINCELLS 100000  // smaller loops are not worth to run in parallel (OpenMP)
+#define SAFEFILEBLOCK 10000      // records read at a time by MakeFileSafe, made safe in parallel
+#define RECORDSORTRUN 100000     // records sorted in memory at a time by CRecordSort
+#define RECORDSORTMERGE 32       // sorted runs merged at a time by CRecordSort
+
+#define RECODECACHESIZE 4  // recode versions kept per variable and per table for undo/redo
+
 #define INFILE_ERROR -1
 #define INFILE_EOF    0
 #define INFILE_OKE    1
 
-#define BIR_MINMAX 1
-#define BIR_FREQ   2
-#define BIR_UNSAFE 3
-#define BIR_RATE_RISK 4
+#define BIRCELL_NONE       0  // not precomputed: empty cell or Missing2, see GetCellBIR
+#define BIRCELL_VALID      1  // no variable on Missing
+#define BIRCELL_MISSING    2  // some variables on Missing
+#define BIRCELL_ALLMISSING 3  // all variables on Missing, no risk
 
 
 
@@ -66,6 +73,7 @@ enum ErrorCodes {
         E_RANGEWRONG,
 	E_VARINDEXWRONG,
 	E_EMPTYSPEC,
+	E_NOTNESTED,
   
 	// codes recode
 	R_FROMTOOBIG = 3000,
@@ -79,12 +87,6 @@ enum ErrorCodes {
 
 };
 
-enum RecodePhase {
-	CHECK = 10,
-	DESTCODE,
-	SRCCODE
-};
-
 enum FormToCodes {
         FROMTO_TO = 10,   // -23
         FROMTO_SOLO,      // 34